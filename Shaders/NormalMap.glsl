@@ -0,0 +1,9 @@
+// Include from fragment shaders that sample normal maps. SceneConverter stores tangent space
+// normal maps as BC5, x and y only, so z is reconstructed from the unit length. Tangent space
+// normals never point below the surface. Maps decompressed to RGBA8 on devices without BC support
+// keep x and y in red and green as well.
+vec3 DecodeNormalMap(vec2 xy)
+{
+    xy = xy * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
@@ -25,6 +25,8 @@ void FpsCameraWindowObserver::OnMouseButton(int key, int action, int mods)
 {
     if (key == GLFW_MOUSE_BUTTON_LEFT)
         mouseState.pressedLeft = (action == GLFW_PRESS);
+    if (key == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
+        mouseState.pickRequested = true;
 }
 
 void FpsCameraWindowObserver::OnKey(int key, int scancode, int action, int mods)
@@ -74,6 +76,16 @@ FirstPersonCameraController& FpsCameraWindowObserver::getCameraController()
     return mCameraController;
 }
 
+bool FpsCameraWindowObserver::ConsumePickRequest(vec2& outPosition)
+{
+    if (!mouseState.pickRequested)
+        return false;
+
+    mouseState.pickRequested = false;
+    outPosition = mouseState.position;
+    return true;
+}
+
 MainRenderer::MainRenderer(Window& window)
     : m_Window(window), mFpsCamWindowObserver(m_Window),
       mCamera(mFpsCamWindowObserver.getCameraController())
@@ -88,11 +100,11 @@ MainRenderer::MainRenderer(Window& window)
 
     m_SceneRenderer = std::make_unique<SceneRenderer>(m_RenderDevice.get(), m_Window);
 
-    const auto swapchainImageCount = m_Device->GetSwapchainImageCount();
-    m_CommandLists.resize(swapchainImageCount);
-    for (int i = 0; i < swapchainImageCount; i++)
+    // One per frame slot, re-recorded once BeginFrame waited for the slot.
+    m_CommandLists.resize(MAX_FRAMES_IN_FLIGHT);
+    for (auto& commandList : m_CommandLists)
     {
-        m_CommandLists[i] = m_Device->CreateCommandList({});
+        commandList = m_Device->CreateCommandList({});
     }
 
     Init();
@@ -105,13 +117,12 @@ MainRenderer::~MainRenderer()
 
 void MainRenderer::Render()
 {
-    m_Device->SwapchainAcquireNextImage();
+    m_Device->BeginFrame();
 
-    // Update after acquiring image.
+    // Update once the frame slot's buffers are no longer read by the GPU.
     m_SceneRenderer->UpdateBuffers();
 
-    auto imageIndex = m_Device->GetCurrentSwapchainImageIndex();
-    auto& commandList = m_CommandLists[imageIndex];
+    auto& commandList = m_CommandLists[m_Device->GetFrameIndex()];
 
     commandList->Begin();
 
@@ -119,8 +130,11 @@ void MainRenderer::Render()
 
     commandList->End();
 
+    // Uploads recorded while updating, the frame waits for them on the GPU.
+    m_RenderDevice->FlushUploads();
+
     m_Device->Submit(commandList);
-    m_Device->Present();
+    m_Device->EndFrame();
 }
 
 void MainRenderer::Update(float deltaSeconds)
@@ -136,6 +150,29 @@ void MainRenderer::Update(float deltaSeconds)
 
     m_SceneRenderer->SetMatrices(p, view);
     m_SceneRenderer->SetCameraPosition(mCamera.getPosition());
+    m_SceneRenderer->CullShapes();
+    m_SceneRenderer->SelectShapeLODs();
+
+    vec2 pickPosition;
+    if (mFpsCamWindowObserver.ConsumePickRequest(pickPosition))
+    {
+        const u32 shape = m_SceneRenderer->PickShape(pickPosition * 2.0f - 1.0f);
+        if (shape != u32(-1))
+        {
+            const u32 node = m_SceneData.shapes[shape].transformIndex;
+            LOG_INFO("Picked shape ", shape, ", node ", node, " ",
+                     GetNodeName(m_SceneData.scene, node));
+        }
+    }
+
+    m_CullingStatsTimer += deltaSeconds;
+    if (m_CullingStatsTimer >= 1.0f)
+    {
+        const auto& stats = m_SceneRenderer->GetCullingStats();
+        LOG_DEBUG("Visible shapes: ", stats.visibleShapes, ", culled: ", stats.culledShapes,
+                  ", drawn vertices: ", stats.drawnVertices);
+        m_CullingStatsTimer = 0.0f;
+    }
 }
 
 void MainRenderer::Init()
@@ -167,5 +204,8 @@ void MainRenderer::Init()
 
     m_SceneRenderer->Init(m_SceneData);
 
+    // The first frame waits on the GPU for the scene uploads.
+    m_RenderDevice->FlushUploads();
+
     LOG_INFO("Done creating scene data resources.");
 }
@@ -17,6 +17,9 @@ public:
 
     FirstPersonCameraController& getCameraController();
 
+    // Returns true once per right click, with the cursor position in [0, 1] window coordinates.
+    bool ConsumePickRequest(vec2& outPosition);
+
     void update(float deltaSeconds);
 
 private:
@@ -24,6 +27,7 @@ private:
     {
         vec2 position{0.0f};
         bool pressedLeft{false};
+        bool pickRequested{false};
     } mouseState;
 
 private:
@@ -64,4 +68,7 @@ private:
 
     FpsCameraWindowObserver mFpsCamWindowObserver;
     Camera mCamera;
+
+    // Seconds since the culling stats were last logged.
+    float m_CullingStatsTimer{0.0f};
 };
\ No newline at end of file
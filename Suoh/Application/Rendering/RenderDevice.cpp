@@ -1,6 +1,7 @@
 #include "RenderDevice.h"
 
 #include "Rendering/RenderUtils.h"
+#include "Rendering/TextureDecompression.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -11,16 +12,126 @@
 
 #include <Logger.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <mutex>
+#include <thread>
 
 namespace fs = std::filesystem;
 
+namespace
+{
+
+// Buffers are staged in chunks, so large buffers do not need the whole staging ring at once.
+constexpr u64 UPLOAD_CHUNK_SIZE = 32 * 1024 * 1024;
+
+} // namespace
+
 RenderDevice::RenderDevice(VulkanDevice* device) : device(device)
+{
+    InitBatch(m_GraphicsBatch, QueueType::GRAPHICS);
+    if (device->HasTransferQueue())
+        InitBatch(m_TransferBatch, QueueType::TRANSFER);
+}
+
+void RenderDevice::InitBatch(UploadBatch& batch, QueueType queueType)
 {
     CommandListDesc uploadListDesc;
+    uploadListDesc.queueType = queueType;
     uploadListDesc.usage = CommandListUsage::TRANSFER;
 
-    m_UploadCommandList = device->CreateCommandList(uploadListDesc);
+    for (auto& commandList : batch.commandLists)
+        commandList = device->CreateCommandList(uploadListDesc);
+}
+
+CommandList* RenderDevice::OpenBatch(UploadBatch& batch)
+{
+    auto& commandList = batch.commandLists[batch.current];
+    if (!batch.recording)
+    {
+        // The command list may still be executing an older batch. The wait has no timeout, it only
+        // fails once the device is lost and nothing executes anymore.
+        if (!device->WaitForSubmission(commandList->desc.queueType,
+                                       batch.submissionIDs[batch.current]))
+        {
+            LOG_ERROR("RenderDevice: Failed to wait for the previous upload batch.");
+        }
+
+        commandList->Begin();
+        batch.recording = true;
+    }
+
+    return commandList;
+}
+
+u64 RenderDevice::SubmitBatch(UploadBatch& batch)
+{
+    if (!batch.recording)
+        return 0;
+
+    auto& commandList = batch.commandLists[batch.current];
+    commandList->End();
+
+    const u64 submissionID = device->Submit(commandList);
+
+    batch.submissionIDs[batch.current] = submissionID;
+    batch.current = (batch.current + 1) % UPLOAD_BATCH_LIST_COUNT;
+    batch.recording = false;
+
+    return submissionID;
+}
+
+template <typename WriteFunc>
+bool RenderDevice::StageUpload(UploadBatch& batch, u64 size, WriteFunc write)
+{
+    if (!write(OpenBatch(batch)))
+    {
+        // The staging ring is full of unsubmitted uploads, submit them so their memory is freed
+        // once they finish.
+        FlushUploads();
+        if (!write(OpenBatch(batch)))
+        {
+            LOG_ERROR("Failed to stage ", size, " bytes of upload data!");
+            return false;
+        }
+    }
+
+    m_StagedSize += size;
+    if (m_StagedSize >= device->GetUploadManager().GetSize() / 4)
+        FlushUploads();
+
+    return true;
+}
+
+UploadToken RenderDevice::FlushUploads()
+{
+    UploadToken token;
+
+    token.graphicsSubmissionID = SubmitBatch(m_GraphicsBatch);
+    token.transferSubmissionID = SubmitBatch(m_TransferBatch);
+    if (token.transferSubmissionID != 0)
+        m_LastTransferSubmissionID = token.transferSubmissionID;
+
+    // The graphics batch consumed any earlier wait, register it again for the next submission,
+    // which is the one reading the buffers.
+    if (m_LastTransferSubmissionID != 0
+        && (token.graphicsSubmissionID != 0 || token.transferSubmissionID != 0))
+    {
+        device->GraphicsWaitForTransfer(m_LastTransferSubmissionID,
+                                        vk::PipelineStageFlagBits::eAllCommands);
+    }
+
+    m_StagedSize = 0;
+
+    return token;
+}
+
+void RenderDevice::WaitForUploads(const UploadToken& token)
+{
+    device->WaitForSubmission(QueueType::GRAPHICS, token.graphicsSubmissionID);
+    device->WaitForSubmission(QueueType::TRANSFER, token.transferSubmissionID);
 }
 
 ImageHandle RenderDevice::CreateTextureImage(const void* data, u32 width, u32 height,
@@ -51,22 +162,22 @@ ImageHandle RenderDevice::CreateTextureImage(const void* data, u32 width, u32 he
 
 ImageHandle RenderDevice::CreateTextureImage(const std::string& fileName)
 {
-    // Load the image.
-    int texWidth;
-    int texHeight;
-    int texChannels;
+    TextureData texture;
+    if (!DecodeTexture(fileName, texture))
+        return nullptr;
 
-    stbi_uc* pixels
-        = stbi_load(fileName.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-    if (!pixels)
-    {
-        LOG_ERROR("Failed to load texture: ", fs::absolute(fileName));
+    return CreateTextureImage(texture);
+}
+
+ImageHandle RenderDevice::CreateTextureImage(const TextureData& texture)
+{
+    auto image = CreateImage(texture);
+    if (!image)
         return nullptr;
-    }
 
-    auto image = CreateTextureImage(pixels, texWidth, texHeight, vk::Format::eR8G8B8A8Unorm);
+    StageTexture(image, texture, true);
 
-    stbi_image_free(pixels);
+    image->CreateSubresourceView();
 
     return image;
 }
@@ -108,40 +219,336 @@ ImageHandle RenderDevice::CreateCubemapTextureImage(const std::string& fileName)
                               vk::ImageViewType::eCube);
 }
 
-ImageHandle RenderDevice::CreateKTXTextureImage(const std::string& fileName)
+static vk::Format ToVkFormat(gli::format format)
 {
-    gli::texture gliTex = gli::load_ktx(fileName);
-    glm::tvec3<u32> extent(gliTex.extent(0));
+    switch (format)
+    {
+    case gli::FORMAT_RGBA8_UNORM_PACK8:
+        return vk::Format::eR8G8B8A8Unorm;
+    case gli::FORMAT_RG16_SFLOAT_PACK16:
+        return vk::Format::eR16G16Sfloat;
+    case gli::FORMAT_RGBA16_SFLOAT_PACK16:
+        return vk::Format::eR16G16B16A16Sfloat;
+    case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8:
+        return vk::Format::eBc1RgbUnormBlock;
+    case gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+        return vk::Format::eBc1RgbaUnormBlock;
+    case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+        return vk::Format::eBc3UnormBlock;
+    case gli::FORMAT_R_ATI1N_UNORM_BLOCK8:
+        return vk::Format::eBc4UnormBlock;
+    case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16:
+        return vk::Format::eBc5UnormBlock;
+    case gli::FORMAT_RGBA_BP_UNORM_BLOCK16:
+        return vk::Format::eBc7UnormBlock;
+    default:
+        break;
+    }
+    return vk::Format::eUndefined;
+}
 
-    auto image = CreateTextureImage((u8*)gliTex.data(0, 0, 0), extent.x, extent.y,
-                                    vk::Format::eR16G16Sfloat);
+bool RenderDevice::DecodeTexture(const std::string& fileName, TextureData& outTexture) const
+{
+    outTexture = {};
 
-    return image;
+    if (fileName.ends_with(".ktx"))
+    {
+        gli::texture gliTex = gli::load_ktx(fileName);
+        if (gliTex.empty())
+        {
+            LOG_ERROR("Failed to load texture: ", fs::absolute(fileName));
+            return false;
+        }
+
+        const auto format = ToVkFormat(gliTex.format());
+        if (format == vk::Format::eUndefined)
+        {
+            LOG_ERROR("Unsupported texture format ", (u32)gliTex.format(), " in ", fileName);
+            return false;
+        }
+
+        glm::tvec3<u32> extent(gliTex.extent(0));
+
+        // Without BC support the blocks are decompressed to RGBA8, mip by mip.
+        if (gli::is_compressed(gliTex.format()) && !device->SupportsTextureCompressionBC())
+        {
+            TextureData texture;
+            texture.format = vk::Format::eR8G8B8A8Unorm;
+            texture.width = extent.x;
+            texture.height = extent.y;
+
+            std::vector<u8> mip;
+            for (size_t level = 0; level < gliTex.levels(); level++)
+            {
+                const u32 mipWidth = std::max(extent.x >> level, 1u);
+                const u32 mipHeight = std::max(extent.y >> level, 1u);
+                if (!DecompressImage(format, (const u8*)gliTex.data(0, 0, level), mipWidth,
+                                     mipHeight, mip))
+                {
+                    LOG_ERROR("Texture format ", (u32)gliTex.format(), " in ", fileName,
+                              " needs BC texture compression, which the device does not support");
+                    return false;
+                }
+
+                texture.data.insert(texture.data.end(), mip.begin(), mip.end());
+                texture.mipSizes.push_back(mip.size());
+            }
+
+            outTexture = std::move(texture);
+            return true;
+        }
+
+        outTexture.format = format;
+        outTexture.width = extent.x;
+        outTexture.height = extent.y;
+
+        // Mips are already compressed, keep them as stored.
+        outTexture.data.resize(gliTex.size());
+        u64 offset = 0;
+        for (size_t level = 0; level < gliTex.levels(); level++)
+        {
+            const u64 size = gliTex.size(level);
+            memcpy(outTexture.data.data() + offset, gliTex.data(0, 0, level), size);
+            outTexture.mipSizes.push_back(size);
+            offset += size;
+        }
+
+        return true;
+    }
+
+    int texWidth;
+    int texHeight;
+    int texChannels;
+
+    stbi_uc* pixels
+        = stbi_load(fileName.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+    if (!pixels)
+    {
+        LOG_ERROR("Failed to load texture: ", fs::absolute(fileName));
+        return false;
+    }
+
+    const u64 size = (u64)texWidth * texHeight * 4;
+
+    outTexture.format = vk::Format::eR8G8B8A8Unorm;
+    outTexture.width = texWidth;
+    outTexture.height = texHeight;
+    outTexture.data.assign(pixels, pixels + size);
+    outTexture.mipSizes.push_back(size);
+
+    stbi_image_free(pixels);
+
+    return true;
+}
+
+ImageHandle RenderDevice::CreateImage(const TextureData& texture)
+{
+    ImageDesc imageDesc;
+    imageDesc.width = texture.width;
+    imageDesc.height = texture.height;
+    imageDesc.format = texture.format;
+    imageDesc.usage = vk::ImageUsageFlagBits::eSampled;
+    imageDesc.tiling = vk::ImageTiling::eOptimal;
+    imageDesc.mipLevels = (u32)texture.mipSizes.size();
+
+    return device->CreateImage(imageDesc);
+}
+
+bool RenderDevice::StageTexture(Image* image, const TextureData& texture, bool transitionLayout)
+{
+    std::vector<ImageMipData> mips;
+    u64 offset = 0;
+    for (const auto size : texture.mipSizes)
+    {
+        mips.push_back({.data = texture.data.data() + offset, .size = size});
+        offset += size;
+    }
+
+    return StageUpload(m_GraphicsBatch, texture.data.size(), [&](CommandList* commandList) {
+        return commandList->WriteImageMips(image, mips, transitionLayout);
+    });
+}
+
+std::vector<ImageHandle> RenderDevice::LoadTextures(const StringTable& fileNames,
+                                                    TextureLoadTimings& outTimings)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const auto start = Clock::now();
+    const auto secondsSince = [](Clock::time_point time) {
+        return std::chrono::duration<double>(Clock::now() - time).count();
+    };
+
+    const u32 count = (u32)fileNames.size();
+
+    // The main thread is busy staging, leave it a core.
+    const u32 hardwareJobs = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    const u32 workerCount = std::min(hardwareJobs, count);
+    // Bounds the decoded memory waiting to be staged.
+    const u32 maxDecodedTextures = 2 * workerCount;
+
+    std::vector<TextureData> textures(count);
+
+    // Guarded by mutex, workers signal decodedCondition, the main thread stagedCondition.
+    std::mutex mutex;
+    std::condition_variable decodedCondition;
+    std::condition_variable stagedCondition;
+    std::vector<u8> decoded(count, false);
+    u32 stagedCount = 0;
+    Clock::time_point decodeEnd = start;
+
+    std::atomic<u32> nextTexture{0};
+
+    const auto worker = [&]() {
+        for (u32 i = nextTexture++; i < count; i = nextTexture++)
+        {
+            {
+                std::unique_lock lock(mutex);
+                stagedCondition.wait(lock, [&]() { return i < stagedCount + maxDecodedTextures; });
+            }
+
+            // Failed textures are left empty and get a null image.
+            TextureData texture;
+            DecodeTexture(std::string(fileNames[i]), texture);
+
+            {
+                std::lock_guard lock(mutex);
+                textures[i] = std::move(texture);
+                decoded[i] = true;
+                decodeEnd = Clock::now();
+            }
+            decodedCondition.notify_all();
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (u32 i = 0; i < workerCount; i++)
+        workers.emplace_back(worker);
+
+    std::vector<ImageHandle> images(count);
+    std::vector<Image*> loadedImages;
+    double uploadSeconds = 0.0;
+    double transitionSeconds = 0.0;
+
+    // Stage every texture decoded so far in order, their transitions share a single barrier.
+    u32 groupStart = 0;
+    while (groupStart < count)
+    {
+        u32 groupEnd = groupStart;
+        {
+            std::unique_lock lock(mutex);
+            decodedCondition.wait(lock, [&]() { return decoded[groupStart] != 0; });
+
+            while (groupEnd < count && decoded[groupEnd])
+                groupEnd++;
+        }
+
+        auto time = Clock::now();
+
+        const size_t groupImageStart = loadedImages.size();
+        for (u32 i = groupStart; i < groupEnd; i++)
+        {
+            if (textures[i].mipSizes.empty())
+                continue;
+
+            images[i] = CreateImage(textures[i]);
+            if (images[i])
+                loadedImages.push_back(images[i]);
+        }
+
+        uploadSeconds += secondsSince(time);
+        time = Clock::now();
+
+        const std::span<Image* const> groupImages(loadedImages.begin() + groupImageStart,
+                                                  loadedImages.end());
+        OpenBatch(m_GraphicsBatch)
+            ->TransitionImageLayouts(groupImages, vk::ImageLayout::eTransferDstOptimal);
+
+        transitionSeconds += secondsSince(time);
+        time = Clock::now();
+
+        for (u32 i = groupStart; i < groupEnd; i++)
+        {
+            if (images[i])
+            {
+                StageTexture(images[i], textures[i], false);
+                images[i]->CreateSubresourceView();
+            }
+
+            // Staged data is copied to the ring, free it right away.
+            textures[i] = {};
+        }
+
+        uploadSeconds += secondsSince(time);
+
+        {
+            std::lock_guard lock(mutex);
+            stagedCount = groupEnd;
+        }
+        stagedCondition.notify_all();
+
+        groupStart = groupEnd;
+    }
+
+    for (auto& thread : workers)
+        thread.join();
+
+    // Wait for the copies and the transitions separately to time them.
+    auto time = Clock::now();
+    WaitForUploads(FlushUploads());
+    uploadSeconds += secondsSince(time);
+
+    time = Clock::now();
+    OpenBatch(m_GraphicsBatch)
+        ->TransitionImageLayouts(loadedImages, vk::ImageLayout::eShaderReadOnlyOptimal);
+    WaitForUploads(FlushUploads());
+    transitionSeconds += secondsSince(time);
+
+    outTimings.decodeSeconds = std::chrono::duration<double>(decodeEnd - start).count();
+    outTimings.uploadSeconds = uploadSeconds;
+    outTimings.transitionSeconds = transitionSeconds;
+    outTimings.totalSeconds = secondsSince(start);
+
+    return images;
 }
 
-void RenderDevice::UploadBufferData(BufferHandle buffer, const void* data, u32 size, u32 dstOffset)
+void RenderDevice::UploadBufferData(BufferHandle buffer, const void* data, u64 size, u64 dstOffset)
 {
-    m_UploadCommandList->Begin();
-    m_UploadCommandList->WriteBuffer(buffer, data, size, dstOffset);
-    m_UploadCommandList->End();
-    device->Submit(m_UploadCommandList);
-    device->WaitGraphicsSubmissionSemaphore();
+    auto& batch = GetBufferBatch();
+
+    for (u64 offset = 0; offset < size; offset += UPLOAD_CHUNK_SIZE)
+    {
+        const u64 chunkSize = std::min(size - offset, UPLOAD_CHUNK_SIZE);
+
+        const bool staged = StageUpload(batch, chunkSize, [&](CommandList* commandList) {
+            if (!commandList->WriteBuffer(buffer, (const u8*)data + offset, chunkSize,
+                                          dstOffset + offset))
+                return false;
+
+            // Submissions on the same queue do not make the copy visible without a barrier.
+            if (&batch == &m_GraphicsBatch)
+            {
+                commandList->BufferBarrier(buffer, vk::PipelineStageFlagBits::eTransfer,
+                                           vk::AccessFlagBits::eTransferWrite,
+                                           vk::PipelineStageFlagBits::eAllCommands,
+                                           vk::AccessFlagBits::eMemoryRead);
+            }
+
+            return true;
+        });
+        if (!staged)
+            return;
+    }
 }
 
 void RenderDevice::UploadImageData(ImageHandle image, const void* imageData)
 {
-    m_UploadCommandList->Begin();
-    m_UploadCommandList->WriteImage(image, imageData);
-    m_UploadCommandList->End();
-    device->Submit(m_UploadCommandList);
-    device->WaitGraphicsSubmissionSemaphore();
+    StageUpload(m_GraphicsBatch, image->GetMipSize(0), [&](CommandList* commandList) {
+        return commandList->WriteImage(image, imageData);
+    });
 }
 
 void RenderDevice::TransitionImageLayout(Image* image, vk::ImageLayout layout)
 {
-    m_UploadCommandList->Begin();
-    m_UploadCommandList->TransitionImageLayout(image, layout);
-    m_UploadCommandList->End();
-    device->Submit(m_UploadCommandList);
-    device->WaitGraphicsSubmissionSemaphore();
+    OpenBatch(m_GraphicsBatch)->TransitionImageLayout(image, layout);
 }
@@ -2,9 +2,43 @@
 
 #include <RenderLib/Vulkan/VulkanDevice.h>
 
+#include <StringTable.h>
+
+#include <array>
+
 using namespace RenderLib;
 using namespace RenderLib::Vulkan;
 
+// Submissions of a FlushUploads call, 0 for queues it did not submit to.
+struct UploadToken
+{
+    u64 graphicsSubmissionID{0};
+    u64 transferSubmissionID{0};
+};
+
+// Texture decoded on the CPU, mip levels tightly packed one after another in data.
+struct TextureData
+{
+    vk::Format format{vk::Format::eUndefined};
+    u32 width{0};
+    u32 height{0};
+
+    std::vector<u64> mipSizes;
+    std::vector<u8> data;
+};
+
+/*
+ * Time spent in each phase of RenderDevice::LoadTextures. Decoding runs on worker threads and
+ * overlaps with the upload and transition phases, which include waiting for the GPU.
+ */
+struct TextureLoadTimings
+{
+    double decodeSeconds{0.0};
+    double uploadSeconds{0.0};
+    double transitionSeconds{0.0};
+    double totalSeconds{0.0};
+};
+
 /*
  * Light wrapper around API device.
  * XXX: Use a proper render graph system? Or make this class act like one with a compilation
@@ -22,16 +56,76 @@ public:
 
     // Loads data from file and creates the image.
     ImageHandle CreateTextureImage(const std::string& fileName);
+    ImageHandle CreateTextureImage(const TextureData& texture);
     ImageHandle CreateCubemapTextureImage(const std::string& fileName);
-    ImageHandle CreateKTXTextureImage(const std::string& fileName);
 
-    void UploadBufferData(BufferHandle buffer, const void* data, u32 size, u32 dstOffset = 0);
+    /*
+     * Decodes a KTX file, or any format stb_image loads as RGBA8. Block compressed KTX files are
+     * decompressed to RGBA8 if the device cannot sample them. Safe to call from any thread.
+     */
+    bool DecodeTexture(const std::string& fileName, TextureData& outTexture) const;
+
+    /*
+     * Decodes the files on a pool of worker threads while this thread stages them into the
+     * upload batches in order, sharing layout transitions between all textures decoded so far.
+     * Waits for the GPU before returning, images of files that failed to load are null.
+     */
+    std::vector<ImageHandle> LoadTextures(const StringTable& fileNames,
+                                          TextureLoadTimings& outTimings);
+
+    /*
+     * Uploads and transitions are recorded into batches and only submitted by FlushUploads, or
+     * when a batch staged a large part of the staging ring. Data is copied to staging memory
+     * right away, so it can be freed on return. Buffers are uploaded on the transfer queue when
+     * the device has one, images on the graphics queue, which owns them and their layouts.
+     */
+    void UploadBufferData(BufferHandle buffer, const void* data, u64 size, u64 dstOffset = 0);
     void UploadImageData(ImageHandle image, const void* imageData);
 
     void TransitionImageLayout(Image* image, vk::ImageLayout layout);
 
+    /*
+     * Submits the recorded batches. The next graphics submission waits on the GPU for the
+     * transfer queue, so rendering can use the uploads without waiting on the host.
+     */
+    UploadToken FlushUploads();
+    // Waits on the host for the uploads of a FlushUploads call.
+    void WaitForUploads(const UploadToken& token);
+
     VulkanDevice* device;
 
 private:
-    CommandListHandle m_UploadCommandList;
+    // Command lists are alternated, recording the next batch while the previous one executes.
+    static constexpr u32 UPLOAD_BATCH_LIST_COUNT = 2;
+
+    struct UploadBatch
+    {
+        std::array<CommandListHandle, UPLOAD_BATCH_LIST_COUNT> commandLists;
+        std::array<u64, UPLOAD_BATCH_LIST_COUNT> submissionIDs{};
+        u32 current{0};
+        bool recording{false};
+    };
+
+    ImageHandle CreateImage(const TextureData& texture);
+    bool StageTexture(Image* image, const TextureData& texture, bool transitionLayout);
+
+    void InitBatch(UploadBatch& batch, QueueType queueType);
+    CommandList* OpenBatch(UploadBatch& batch);
+    u64 SubmitBatch(UploadBatch& batch);
+
+    // Records write into the batch, flushing to make room in the staging ring when needed.
+    template <typename WriteFunc> bool StageUpload(UploadBatch& batch, u64 size, WriteFunc write);
+
+    UploadBatch& GetBufferBatch()
+    {
+        return device->HasTransferQueue() ? m_TransferBatch : m_GraphicsBatch;
+    }
+
+private:
+    UploadBatch m_GraphicsBatch;
+    UploadBatch m_TransferBatch;
+
+    // Bytes staged since the last flush.
+    u64 m_StagedSize{0};
+    u64 m_LastTransferSubmissionID{0};
 };
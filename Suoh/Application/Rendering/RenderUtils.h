@@ -73,6 +73,13 @@ inline BufferDescriptorItem MakeFSStorageBufferDescriptor(BufferHandle buffer, u
                                 vk::ShaderStageFlagBits::eFragment, size, offSet);
 }
 
+inline BufferDescriptorItem MakeCSStorageBufferDescriptor(BufferHandle buffer, u32 size,
+                                                          u32 offSet = 0)
+{
+    return MakeBufferDescriptor(buffer, vk::DescriptorType::eStorageBuffer,
+                                vk::ShaderStageFlagBits::eCompute, size, offSet);
+}
+
 inline BufferDescriptorItem MakeVSFSStorageBufferDescriptor(BufferHandle buffer, u32 size,
                                                             u32 offSet = 0)
 {
@@ -19,20 +19,24 @@ bool SceneData::Load(const std::string& meshFile, const std::string& sceneFile,
         return false;
     }
 
-    // Setup scene drawdata.
-    for (const auto& c : scene.meshesMap)
+    // Setup scene drawdata, shapes come out in node order.
+    shapes.reserve(scene.meshIds.size());
+    for (size_t i = 0; i < scene.meshIds.size(); i++)
     {
-        auto material = scene.materialsMap.find(c.first);
-        if (material == scene.materialsMap.end())
+        const u32 node = scene.meshIds.nodes[i];
+        const u32 mesh = scene.meshIds.values[i];
+
+        const u32 material = GetComponent(scene.materialIds, node);
+        if (material == u32(-1))
             continue;
 
         shapes.push_back(DrawData{
-            .meshIndex = c.second,
-            .materialIndex = material->second,
+            .meshIndex = mesh,
+            .materialIndex = material,
             .LOD = 0,
-            .indexOffset = meshData.meshes[c.second].indexOffset,
-            .vertexOffset = meshData.meshes[c.second].vertexOffset,
-            .transformIndex = c.first,
+            .indexOffset = meshData.meshes[mesh].indexOffset,
+            .vertexOffset = meshData.meshes[mesh].vertexOffset,
+            .transformIndex = node,
         });
     }
     shapeTransforms.resize(shapes.size());
@@ -44,48 +48,67 @@ void SceneData::InitializeGPUResources(RenderDevice* renderDevice)
 {
     auto device = renderDevice->device;
 
-    auto brdfLUTImage = renderDevice->CreateKTXTextureImage("../Resources/brdfLUT.ktx");
+    auto brdfLUTImage = renderDevice->CreateTextureImage("../Resources/brdfLUT.ktx");
     auto brdfLUTSampler = device->CreateSampler({});
     brdfLUT = MakeTexture(brdfLUTImage, brdfLUTSampler);
 
-    // Create material textures.
-    for (const auto& file : textureFiles)
+    // Create material textures. Converted textures are block compressed KTX files with a full
+    // mip chain, others are decoded to RGBA8.
+    TextureLoadTimings timings;
+    auto images = renderDevice->LoadTextures(textureFiles, timings);
+
+    LOG_INFO("Loaded ", images.size(), " textures in ", timings.totalSeconds,
+             "s (decode: ", timings.decodeSeconds, "s, upload: ", timings.uploadSeconds,
+             "s, layout transitions: ", timings.transitionSeconds, "s)");
+
+    // Materials index textures by position, so files that failed to load share a white texture
+    // instead of being dropped.
+    Texture fallbackTexture;
+    for (auto& image : images)
     {
-        auto image = renderDevice->CreateTextureImage(file);
-        auto sampler = device->CreateSampler({});
-        image->sampler = sampler->sampler;
+        if (!image)
+        {
+            if (!fallbackTexture.image)
+            {
+                const u32 white = 0xffffffff;
+                auto fallbackImage
+                    = renderDevice->CreateTextureImage(&white, 1, 1, vk::Format::eR8G8B8A8Unorm);
+                fallbackTexture = MakeTexture(fallbackImage, device->CreateSampler({}));
+            }
+
+            materialTextures.push_back(fallbackTexture);
+            continue;
+        }
 
-        materialTextures.push_back(MakeTexture(image, sampler));
+        materialTextures.push_back(MakeTexture(image, device->CreateSampler({})));
     }
 
     // Create material buffer.
     BufferDesc mbDesc;
     mbDesc.size = materials.size() * sizeof(MaterialDescription);
     mbDesc.usage = BufferUsage::STORAGE_BUFFER;
+    // Mapped by UploadMaterial.
+    mbDesc.cpuAccess = CpuAccessMode::WRITE;
     materialsBuffer = device->CreateBuffer(mbDesc);
     renderDevice->UploadBufferData(materialsBuffer, materials.data(), mbDesc.size);
 
     // Create vertex and index buffer.
-    auto vertexBufferSize = meshData.vertexData.size() * sizeof(float);
-    auto indexBufferSize = meshData.indexData.size() * sizeof(u32);
+    const auto vertexDataSize = meshData.vertexData.size_bytes();
+    const auto indexBufferSize = meshData.indexData.size_bytes();
 
+    // Index data is placed after the vertex data, at an aligned offset. The mapped file is read
+    // only, so pad the offset instead of appending padding to the vertex data.
     // XXX: Properly get this from device.
     const auto offsetAlignment = 64;
-    if ((vertexBufferSize & (offsetAlignment - 1)) != 0)
-    {
-        const size_t numFloats
-            = (offsetAlignment - (vertexBufferSize & (offsetAlignment - 1))) / sizeof(float);
-        for (size_t i = 0; i != numFloats; i++)
-            meshData.vertexData.push_back(0);
-        vertexBufferSize = (vertexBufferSize + offsetAlignment) & ~(offsetAlignment - 1);
-    }
+    const auto vertexBufferSize = (vertexDataSize + offsetAlignment - 1) & ~(offsetAlignment - 1);
 
     BufferDesc sbDesc;
     sbDesc.size = vertexBufferSize + indexBufferSize;
     sbDesc.usage = BufferUsage::STORAGE_BUFFER;
     storageBuffer = device->CreateBuffer(sbDesc);
 
-    renderDevice->UploadBufferData(storageBuffer, meshData.vertexData.data(), vertexBufferSize, 0);
+    // Staged straight from the file mapping.
+    renderDevice->UploadBufferData(storageBuffer, meshData.vertexData.data(), vertexDataSize, 0);
     renderDevice->UploadBufferData(storageBuffer, meshData.indexData.data(), indexBufferSize,
                                    vertexBufferSize);
 
@@ -98,6 +121,13 @@ void SceneData::InitializeGPUResources(RenderDevice* renderDevice)
     tbDesc.cpuAccess = CpuAccessMode::WRITE;
     transformsBuffer = device->CreateBuffer(tbDesc);
 
+    // Create mesh bounds buffer, read when culling on the GPU.
+    BufferDesc bbDesc;
+    bbDesc.size = meshData.boundingBoxes.size_bytes();
+    bbDesc.usage = BufferUsage::STORAGE_BUFFER;
+    meshBoundsBuffer = device->CreateBuffer(bbDesc);
+    renderDevice->UploadBufferData(meshBoundsBuffer, meshData.boundingBoxes.data(), bbDesc.size);
+
     std::vector<ImageHandle> materialImages;
     for (const auto& texture : materialTextures)
         materialImages.push_back(texture.image);
@@ -143,4 +173,17 @@ void SceneData::RecalculateTransforms()
 {
     MarkAsChanged(scene, 0);
     RecalculateGlobalTransforms(scene);
+
+    UpdateShapeBounds();
+}
+
+void SceneData::UpdateShapeBounds()
+{
+    ComputeShapeBounds(scene, shapes, meshData.boundingBoxes, shapeBounds);
+
+    // The tree is built once, moving shapes only refit it.
+    if (shapeBVH.nodes.empty())
+        BuildBVH(shapeBVH, shapeBounds);
+    else
+        RefitBVH(shapeBVH, shapeBounds);
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <RenderLib/Vulkan/VulkanDevice.h>
 
+#include <RenderDescription/BVH.h>
 #include <RenderDescription/Material.h>
 #include <RenderDescription/Mesh.h>
 #include <RenderDescription/Scene.h>
@@ -10,19 +11,23 @@
 
 struct SceneData
 {
-    // Render descriptions.
-    MeshData meshData;
+    // Render descriptions. Mesh data is a view into the mapped .meshes file.
+    MappedMeshData meshData;
     Scene scene;
 
     u32 framebufferWidth;
     u32 framebufferHeight;
 
     std::vector<MaterialDescription> materials;
-    std::vector<std::string> textureFiles;
+    StringTable textureFiles;
 
     std::vector<mat4> shapeTransforms;
     std::vector<DrawData> shapes;
 
+    // World space shape bounds and the BVH over them, indexed like shapes.
+    std::vector<BoundingBox> shapeBounds;
+    BVH shapeBVH;
+
     // GPU resources.
     Texture envMap;
     Texture envMapIrradiance;
@@ -30,6 +35,8 @@ struct SceneData
 
     BufferHandle materialsBuffer;
     BufferHandle transformsBuffer;
+    // Mesh space bounds, indexed by mesh.
+    BufferHandle meshBoundsBuffer;
 
     // Storage buffer for vertex and index data.
     BufferHandle storageBuffer;
@@ -46,6 +53,7 @@ struct SceneData
     // Scene calculations.
     void UpdateShapeTransforms();
     void RecalculateTransforms();
+    void UpdateShapeBounds();
 
     // GPU operations.
     void InitializeGPUResources(RenderDevice* renderDevice);
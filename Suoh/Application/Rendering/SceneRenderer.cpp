@@ -10,17 +10,23 @@ void SceneRenderer::Init(SceneData& sceneData)
 {
     m_SceneData = &sceneData;
 
-    const auto imageCount = m_Device->GetSwapchainImageCount();
+    // Buffers written by the CPU every frame, and the sets using them, are per frame slot.
+    const auto frameCount = MAX_FRAMES_IN_FLIGHT;
 
-    m_UniformBuffers.resize(imageCount);
-    m_Shapes.resize(imageCount);
-    m_IndirectBuffers.resize(imageCount);
-    m_DescriptorSets.resize(imageCount);
+    m_UniformBuffers.resize(frameCount);
+    m_Shapes.resize(frameCount);
+    m_IndirectBuffers.resize(frameCount);
+    m_DescriptorSets.resize(frameCount);
 
     const auto indirectDataSize = m_SceneData->shapes.size() * sizeof(VkDrawIndirectCommand);
     const auto shapesSize = m_SceneData->shapes.size() * sizeof(DrawData);
     constexpr auto uniformBufferSize = sizeof(m_Ubo);
 
+    // Everything is visible until the first CullShapes.
+    m_ShapeVisibility = std::make_unique<bool[]>(m_SceneData->shapes.size());
+    std::fill_n(m_ShapeVisibility.get(), m_SceneData->shapes.size(), true);
+    m_CullingStats = {.visibleShapes = (u32)m_SceneData->shapes.size()};
+
     m_DescriptorLayoutDesc.imageDescriptors = {
         MakeFSImageDescriptor(sceneData.envMap.image),
         MakeFSImageDescriptor(sceneData.envMapIrradiance.image),
@@ -38,10 +44,10 @@ void SceneRenderer::Init(SceneData& sceneData)
                                       sceneData.materialsBuffer->desc.size),
     };
     m_DescriptorLayoutDesc.imageArrayDescriptors = {sceneData.materialImagesDescriptor};
-    m_DescriptorLayoutDesc.poolCountMultiplier = imageCount;
+    m_DescriptorLayoutDesc.poolCountMultiplier = frameCount;
     m_DescriptorLayout = m_Device->CreateDescriptorLayout(m_DescriptorLayoutDesc);
 
-    for (unsigned int i = 0; i < imageCount; i++)
+    for (unsigned int i = 0; i < frameCount; i++)
     {
         BufferDesc uboDesc;
         uboDesc.usage = BufferUsage::UNIFORM_BUFFER;
@@ -50,7 +56,8 @@ void SceneRenderer::Init(SceneData& sceneData)
         m_UniformBuffers[i] = m_Device->CreateBuffer(uboDesc);
 
         BufferDesc indirectDesc;
-        indirectDesc.usage = BufferUsage::INDIRECT_BUFFER;
+        // Drawn directly, or read by the cull pass.
+        indirectDesc.usage = BufferUsage::INDIRECT_BUFFER | BufferUsage::STORAGE_BUFFER;
         indirectDesc.size = indirectDataSize;
         // Mappable to CPU for now.
         indirectDesc.cpuAccess = CpuAccessMode::WRITE;
@@ -75,6 +82,14 @@ void SceneRenderer::Init(SceneData& sceneData)
         m_DescriptorSets[i] = m_Device->CreateDescriptorSet(dsDesc);
     }
 
+    m_CullPass = std::make_unique<ShapeCullPass>(m_Device);
+    m_GPUCulling = m_CullPass->Init((u32)m_SceneData->shapes.size(), m_Shapes, m_IndirectBuffers,
+                                    sceneData.transformsBuffer, sceneData.meshBoundsBuffer);
+    if (!m_GPUCulling)
+    {
+        LOG_WARN("SceneRenderer: GPU culling unavailable, culling on the CPU.");
+    }
+
     // Create depth image.
     ImageDesc depthImageDesc;
     depthImageDesc.hasDepth = true;
@@ -100,6 +115,7 @@ void SceneRenderer::Init(SceneData& sceneData)
     m_RenderPass = m_Device->CreateRenderPass(rpDesc);
 
     // Create swapchain framebuffers.
+    const auto imageCount = m_Device->GetSwapchainImageCount();
     m_SwapchainFramebuffers.resize(imageCount);
     const auto& swapchainImages = m_Device->GetSwapchainImages();
     FramebufferDesc fbDesc;
@@ -138,45 +154,143 @@ void SceneRenderer::Init(SceneData& sceneData)
 
 void SceneRenderer::RecordCommands(CommandListHandle commandList)
 {
+    const auto frameIndex = m_Device->GetFrameIndex();
     const auto imageIndex = m_Device->GetCurrentSwapchainImageIndex();
 
+    const auto shapeCount = static_cast<u32>(m_SceneData->shapes.size());
+
+    // Shapes are drawn with proj * view (including the y flip) * model.
+    if (m_GPUCulling)
+        m_CullPass->Record(commandList, frameIndex, m_Ubo.proj * m_Ubo.view);
+
     GraphicsState graphicsState;
-    graphicsState.descriptorSet = m_DescriptorSets[imageIndex];
+    graphicsState.descriptorSet = m_DescriptorSets[frameIndex];
     graphicsState.frameBuffer = m_SwapchainFramebuffers[imageIndex];
-    graphicsState.indirectBuffer = m_IndirectBuffers[imageIndex];
     graphicsState.renderPass = m_RenderPass;
     graphicsState.pipeline = m_GraphicsPipeline;
 
-    commandList->SetGraphicsState(graphicsState);
-    commandList->DrawIndirect(0, static_cast<u32>(m_SceneData->shapes.size()));
+    if (m_GPUCulling)
+    {
+        graphicsState.indirectBuffer = m_CullPass->GetVisibleCommands(frameIndex);
+        graphicsState.indirectCountBuffer = m_CullPass->GetVisibleCount(frameIndex);
+
+        commandList->SetGraphicsState(graphicsState);
+        commandList->DrawIndirectCount(0, offsetof(VisibleCount, drawCount), shapeCount);
+    }
+    else
+    {
+        graphicsState.indirectBuffer = m_IndirectBuffers[frameIndex];
+
+        commandList->SetGraphicsState(graphicsState);
+        commandList->DrawIndirect(0, shapeCount);
+    }
+
     commandList->EndRenderPass();
 }
 
 void SceneRenderer::UpdateBuffers()
 {
-    const auto imageIndex = m_Device->GetCurrentSwapchainImageIndex();
-    const auto buffer = m_UniformBuffers[imageIndex];
+    const auto frameIndex = m_Device->GetFrameIndex();
+    const auto buffer = m_UniformBuffers[frameIndex];
 
     auto mappedMemory = m_Device->MapBuffer(buffer);
     memcpy(mappedMemory, &m_Ubo, sizeof(m_Ubo));
     m_Device->UnmapBuffer(buffer);
+
+    if (m_GPUCulling)
+    {
+        // The cull pass reads every command, the frame that last used this slot finished already.
+        UpdateIndirectBuffers(frameIndex);
+        ReadCullingStats(frameIndex);
+    }
+    else
+    {
+        UpdateIndirectBuffers(frameIndex, m_ShapeVisibility.get());
+    }
 }
 
-void SceneRenderer::UpdateIndirectBuffers(int index, bool* visibility)
+void SceneRenderer::CullShapes()
+{
+    // Shapes are drawn with proj * view (including the y flip) * model.
+    vec4 planes[6];
+    GetFrustumPlanes(m_Ubo.proj * m_Ubo.view, planes);
+
+    m_VisibleShapes.clear();
+    QueryBVHFrustum(m_SceneData->shapeBVH, planes, m_VisibleShapes);
+
+    if (m_GPUCulling)
+        return;
+
+    const u32 shapeCount = (u32)m_SceneData->shapes.size();
+    const u32 visibleCount = (u32)m_VisibleShapes.size();
+
+    std::fill_n(m_ShapeVisibility.get(), shapeCount, false);
+    for (const u32 shape : m_VisibleShapes)
+        m_ShapeVisibility[shape] = true;
+
+    m_CullingStats.visibleShapes = visibleCount;
+    m_CullingStats.culledShapes = shapeCount - visibleCount;
+}
+
+void SceneRenderer::SelectShapeLODs()
+{
+    // The camera position in the y flipped world the shapes are drawn in.
+    const vec3 cameraPosition = vec3(glm::inverse(m_Ubo.view)[3]);
+    // glm::perspective stores 1 / tan(fovY / 2) in proj[1][1].
+    const float tanHalfFovY = 1.0f / m_Ubo.proj[1][1];
+
+    // Shapes outside the frustum keep their LOD until they are visible again.
+    SelectDrawDataLODs(m_SceneData->shapes, m_VisibleShapes, m_SceneData->shapeBounds,
+                       m_SceneData->meshData.meshes, cameraPosition, tanHalfFovY);
+}
+
+u32 SceneRenderer::PickShape(const vec2& ndc) const
+{
+    // Cast from the camera through the point on the far plane, in the y flipped world.
+    const vec4 farPoint = glm::inverse(m_Ubo.proj * m_Ubo.view) * vec4(ndc, 1.0f, 1.0f);
+    const vec3 origin = vec3(glm::inverse(m_Ubo.view)[3]);
+
+    const vec3 toFarPoint = vec3(farPoint) / farPoint.w - origin;
+    const float maxDistance = glm::length(toFarPoint);
+
+    float distance = 0.0f;
+    return RaycastBVH(m_SceneData->shapeBVH, origin, toFarPoint / maxDistance, maxDistance,
+                      distance);
+}
+
+void SceneRenderer::UpdateIndirectBuffers(int index, const bool* visibility)
 {
     auto data = (vk::DrawIndirectCommand*)m_Device->MapBuffer(m_IndirectBuffers[index]);
 
+    u64 drawnVertices = 0;
     for (u32 i = 0; i < m_SceneData->shapes.size(); i++)
     {
-        const auto j = m_SceneData->shapes[i].meshIndex;
+        const auto& mesh = m_SceneData->meshData.meshes[m_SceneData->shapes[i].meshIndex];
         const auto lod = m_SceneData->shapes[i].LOD;
+        const auto instanceCount = visibility ? (visibility[i] ? 1u : 0u) : 1u;
+
+        // The vertex shader reads indices at indexOffset + gl_VertexIndex, so firstVertex selects
+        // the LOD's index range.
         data[i] = {
-            .vertexCount = m_SceneData->meshData.meshes[j].GetLODIndicesCount(lod),
-            .instanceCount = visibility ? (visibility[i] ? 1u : 0u) : 1u,
-            .firstVertex = 0,
+            .vertexCount = mesh.GetLODIndicesCount(lod),
+            .instanceCount = instanceCount,
+            .firstVertex = mesh.lodOffset[lod],
             .firstInstance = i,
         };
+
+        drawnVertices += (u64)data[i].vertexCount * instanceCount;
     }
 
+    m_CullingStats.drawnVertices = drawnVertices;
+
     m_Device->UnmapBuffer(m_IndirectBuffers[index]);
 }
+
+void SceneRenderer::ReadCullingStats(u32 frameIndex)
+{
+    const VisibleCount visibleCount = m_CullPass->ReadVisibleCount(frameIndex);
+
+    m_CullingStats.visibleShapes = visibleCount.drawCount;
+    m_CullingStats.culledShapes = (u32)m_SceneData->shapes.size() - visibleCount.drawCount;
+    m_CullingStats.drawnVertices = visibleCount.vertexCount;
+}
@@ -4,8 +4,18 @@
 
 #include "RenderDevice.h"
 #include "SceneData.h"
+#include "ShapeCullPass.h"
 #include "Window/Window.h"
 
+struct CullingStats
+{
+    u32 visibleShapes{0};
+    u32 culledShapes{0};
+
+    // Vertices issued by the indirect draws at the selected LODs.
+    u64 drawnVertices{0};
+};
+
 class SceneRenderer
 {
 public:
@@ -20,6 +30,38 @@ public:
 
     void UpdateBuffers();
 
+    /*
+     * Queries the shape BVH with the frustum of the current matrices, applied by the next
+     * UpdateBuffers. When the shapes are culled on the GPU the result only limits SelectShapeLODs.
+     */
+    void CullShapes();
+
+    /*
+     * Picks LODs for the current camera, for the shapes found by the last CullShapes, applied by
+     * the next UpdateBuffers.
+     */
+    void SelectShapeLODs();
+
+    /*
+     * Returns the shape whose bounds are hit first by the ray through a point in normalized device
+     * coordinates, or u32(-1). Only tests the bounds, not the triangles.
+     */
+    u32 PickShape(const vec2& ndc) const;
+
+    /*
+     * With GPU culling, the visible shape and vertex counts are read back from the last frame that
+     * used the current frame slot, so they lag MAX_FRAMES_IN_FLIGHT frames behind.
+     */
+    inline const CullingStats& GetCullingStats() const
+    {
+        return m_CullingStats;
+    }
+
+    inline bool IsGPUCullingEnabled() const
+    {
+        return m_GPUCulling;
+    }
+
     inline void SetMatrices(const glm::mat4& proj, const glm::mat4& view)
     {
         const glm::mat4 m1 = glm::scale(glm::mat4(1.f), glm::vec3(1.f, -1.f, 1.f));
@@ -38,7 +80,9 @@ public:
     }
 
 private:
-    void UpdateIndirectBuffers(int index, bool* visibility = nullptr);
+    void UpdateIndirectBuffers(int index, const bool* visibility = nullptr);
+
+    void ReadCullingStats(u32 frameIndex);
 
     struct UBO
     {
@@ -62,6 +106,15 @@ protected:
     std::vector<BufferHandle> m_IndirectBuffers;
     std::vector<BufferHandle> m_Shapes;
 
+    // Shapes in the view frustum and the per shape flags derived from them, written by CullShapes.
+    std::vector<u32> m_VisibleShapes;
+    std::unique_ptr<bool[]> m_ShapeVisibility;
+    CullingStats m_CullingStats;
+
+    // GPU culling, used when the device can draw with vkCmdDrawIndirectCount.
+    bool m_GPUCulling{false};
+    std::unique_ptr<ShapeCullPass> m_CullPass;
+
     ImageHandle m_DepthImage;
     std::vector<FramebufferHandle> m_SwapchainFramebuffers;
 
@@ -0,0 +1,148 @@
+#include "ShapeCullPass.h"
+
+#include <RenderDescription/BVH.h>
+#include <RenderDescription/Mesh.h>
+
+namespace
+{
+
+// Matches CullShapes.comp.
+constexpr u32 CULL_GROUP_SIZE = 64;
+
+struct CullConstants
+{
+    vec4 frustumPlanes[6];
+    u32 shapeCount;
+};
+
+} // namespace
+
+ShapeCullPass::ShapeCullPass(VulkanDevice* device) : m_Device(device)
+{
+}
+
+bool ShapeCullPass::Init(u32 shapeCount, std::span<const BufferHandle> shapes,
+                         std::span<const BufferHandle> commands, const BufferHandle& transforms,
+                         const BufferHandle& meshBounds)
+{
+    if (!m_Device->SupportsDrawIndirectCount())
+    {
+        LOG_WARN("ShapeCullPass: vkCmdDrawIndirectCount not supported.");
+        return false;
+    }
+
+    const auto frameCount = (u32)shapes.size();
+    const auto indirectDataSize = shapeCount * sizeof(VkDrawIndirectCommand);
+
+    m_ShapeCount = shapeCount;
+    m_VisibleCommandBuffers.resize(frameCount);
+    m_VisibleCountBuffers.resize(frameCount);
+    m_DescriptorSets.resize(frameCount);
+
+    m_DescriptorLayoutDesc.bufferDescriptors = {
+        MakeCSStorageBufferDescriptor(nullptr, shapeCount * sizeof(DrawData)),
+        MakeCSStorageBufferDescriptor(transforms, transforms->desc.size),
+        MakeCSStorageBufferDescriptor(meshBounds, meshBounds->desc.size),
+        MakeCSStorageBufferDescriptor(nullptr, indirectDataSize),
+        MakeCSStorageBufferDescriptor(nullptr, indirectDataSize),
+        MakeCSStorageBufferDescriptor(nullptr, sizeof(VisibleCount)),
+    };
+    m_DescriptorLayoutDesc.poolCountMultiplier = frameCount;
+    m_DescriptorLayout = m_Device->CreateDescriptorLayout(m_DescriptorLayoutDesc);
+
+    for (u32 i = 0; i < frameCount; i++)
+    {
+        // Only written and read by the device.
+        BufferDesc visibleCommandsDesc;
+        visibleCommandsDesc.usage = BufferUsage::INDIRECT_BUFFER | BufferUsage::STORAGE_BUFFER;
+        visibleCommandsDesc.size = indirectDataSize;
+        m_VisibleCommandBuffers[i] = m_Device->CreateBuffer(visibleCommandsDesc);
+
+        // Read back for the culling stats.
+        BufferDesc visibleCountDesc;
+        visibleCountDesc.usage = BufferUsage::INDIRECT_BUFFER | BufferUsage::STORAGE_BUFFER;
+        visibleCountDesc.size = sizeof(VisibleCount);
+        visibleCountDesc.cpuAccess = CpuAccessMode::READ;
+        m_VisibleCountBuffers[i] = m_Device->CreateBuffer(visibleCountDesc);
+
+        auto mappedMemory = m_Device->MapBuffer(m_VisibleCountBuffers[i]);
+        memset(mappedMemory, 0, sizeof(VisibleCount));
+        m_Device->UnmapBuffer(m_VisibleCountBuffers[i]);
+
+        // Shapes on binding 0, commands on binding 3 to 5.
+        auto& bufferDescriptors = m_DescriptorLayout->desc.bufferDescriptors;
+        bufferDescriptors[0].buffer = shapes[i];
+        bufferDescriptors[3].buffer = commands[i];
+        bufferDescriptors[4].buffer = m_VisibleCommandBuffers[i];
+        bufferDescriptors[5].buffer = m_VisibleCountBuffers[i];
+
+        DescriptorSetDesc dsDesc;
+        dsDesc.layout = m_DescriptorLayout;
+        m_DescriptorSets[i] = m_Device->CreateDescriptorSet(dsDesc);
+    }
+
+    auto computeShader = m_Device->CreateShader({
+        .fileName = "../Shaders/CullShapes.comp",
+        .type = ShaderType::COMPUTE,
+    });
+
+    ComputePipelineDesc pipelineDesc;
+    pipelineDesc.constSize = sizeof(CullConstants);
+    pipelineDesc.descriptorSetLayout = m_DescriptorLayout->descriptorSetLayout;
+    pipelineDesc.computeShader = computeShader;
+    m_Pipeline = m_Device->CreateComputePipeline(pipelineDesc);
+
+    if (!m_Pipeline)
+    {
+        LOG_WARN("ShapeCullPass: Failed to create cull pipeline.");
+        return false;
+    }
+
+    return true;
+}
+
+void ShapeCullPass::Record(CommandList* commandList, u32 frameIndex, const mat4& viewProj)
+{
+    const auto& visibleCommandBuffer = m_VisibleCommandBuffers[frameIndex];
+    const auto& visibleCountBuffer = m_VisibleCountBuffers[frameIndex];
+
+    commandList->FillBuffer(visibleCountBuffer, 0);
+    commandList->BufferBarrier(
+        visibleCountBuffer, vk::PipelineStageFlagBits::eTransfer,
+        vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eComputeShader,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+
+    CullConstants constants;
+    GetFrustumPlanes(viewProj, constants.frustumPlanes);
+    constants.shapeCount = m_ShapeCount;
+
+    commandList->SetComputeState({
+        .pipeline = m_Pipeline,
+        .descriptorSet = m_DescriptorSets[frameIndex],
+    });
+    commandList->PushComputeConstants(&constants, sizeof(constants));
+    commandList->Dispatch((constants.shapeCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE);
+
+    // The count is also read back on the host once the submission finished.
+    commandList->BufferBarrier(visibleCommandBuffer, vk::PipelineStageFlagBits::eComputeShader,
+                               vk::AccessFlagBits::eShaderWrite,
+                               vk::PipelineStageFlagBits::eDrawIndirect,
+                               vk::AccessFlagBits::eIndirectCommandRead);
+    commandList->BufferBarrier(
+        visibleCountBuffer, vk::PipelineStageFlagBits::eComputeShader,
+        vk::AccessFlagBits::eShaderWrite,
+        vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eHost,
+        vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eHostRead);
+}
+
+VisibleCount ShapeCullPass::ReadVisibleCount(u32 frameIndex)
+{
+    const auto& buffer = m_VisibleCountBuffers[frameIndex];
+
+    VisibleCount visibleCount;
+    auto mappedMemory = m_Device->MapBuffer(buffer);
+    memcpy(&visibleCount, mappedMemory, sizeof(visibleCount));
+    m_Device->UnmapBuffer(buffer);
+
+    return visibleCount;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <CoreTypes.h>
+
+#include <span>
+
+#include "RenderUtils.h"
+
+// Draw and vertex count written by the cull pass.
+struct VisibleCount
+{
+    u32 drawCount;
+    u32 vertexCount;
+};
+
+/*
+ * Frustum culls shapes on the GPU with CullShapes.comp. The draw commands of visible shapes are
+ * compacted into a buffer per frame slot, drawn with vkCmdDrawIndirectCount and the VisibleCount
+ * buffer of the same slot.
+ */
+class ShapeCullPass
+{
+public:
+    explicit ShapeCullPass(VulkanDevice* device);
+
+    NON_COPYABLE(ShapeCullPass);
+    NON_MOVEABLE(ShapeCullPass);
+
+    /*
+     * shapes (DrawData) and commands (one draw command per shape) hold a buffer per frame slot,
+     * transforms (one mat4 per shape) and meshBounds are shared by all slots.
+     * Returns false if the device cannot draw with vkCmdDrawIndirectCount or the shader failed to
+     * compile.
+     */
+    bool Init(u32 shapeCount, std::span<const BufferHandle> shapes,
+              std::span<const BufferHandle> commands, const BufferHandle& transforms,
+              const BufferHandle& meshBounds);
+
+    // Clears the visible count and compacts the visible draw commands, before the render pass.
+    void Record(CommandList* commandList, u32 frameIndex, const mat4& viewProj);
+
+    // Reads the count written by the last finished Record of the frame slot.
+    VisibleCount ReadVisibleCount(u32 frameIndex);
+
+    inline const BufferHandle& GetVisibleCommands(u32 frameIndex) const
+    {
+        return m_VisibleCommandBuffers[frameIndex];
+    }
+
+    inline const BufferHandle& GetVisibleCount(u32 frameIndex) const
+    {
+        return m_VisibleCountBuffers[frameIndex];
+    }
+
+private:
+    VulkanDevice* m_Device{nullptr};
+    u32 m_ShapeCount{0};
+
+    DescriptorLayoutDesc m_DescriptorLayoutDesc;
+    DescriptorLayoutHandle m_DescriptorLayout;
+    std::vector<DescriptorSetHandle> m_DescriptorSets;
+    ComputePipelineHandle m_Pipeline;
+
+    std::vector<BufferHandle> m_VisibleCommandBuffers;
+    std::vector<BufferHandle> m_VisibleCountBuffers;
+};
@@ -0,0 +1,170 @@
+#include "TextureDecompression.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+constexpr u32 BLOCK_DIMENSION = 4;
+constexpr u32 BLOCK_TEXEL_COUNT = BLOCK_DIMENSION * BLOCK_DIMENSION;
+
+void FromRGB565(u16 packed, u8* color)
+{
+    const u8 r = (packed >> 11) & 0x1f;
+    const u8 g = (packed >> 5) & 0x3f;
+    const u8 b = packed & 0x1f;
+
+    color[0] = u8((r << 3) | (r >> 2));
+    color[1] = u8((g << 2) | (g >> 4));
+    color[2] = u8((b << 3) | (b >> 2));
+}
+
+/*
+ * Writes RGB and alpha of a BC1 color block. Color blocks of BC3 always use 4 colors, BC1 selects
+ * 3 colors and transparent black with color0 <= color1.
+ */
+void DecompressColorBlock(const u8* src, bool alwaysFourColors, u8 block[BLOCK_TEXEL_COUNT * 4])
+{
+    u16 color0, color1;
+    u32 indices;
+    memcpy(&color0, src, sizeof(color0));
+    memcpy(&color1, src + 2, sizeof(color1));
+    memcpy(&indices, src + 4, sizeof(indices));
+
+    u8 palette[4][4];
+    FromRGB565(color0, palette[0]);
+    FromRGB565(color1, palette[1]);
+    for (u32 p = 0; p < 4; p++)
+        palette[p][3] = 255;
+
+    for (u32 c = 0; c < 3; c++)
+    {
+        if (alwaysFourColors || color0 > color1)
+        {
+            palette[2][c] = u8((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = u8((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+        else
+        {
+            palette[2][c] = u8((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+
+    if (!alwaysFourColors && color0 <= color1)
+        palette[3][3] = 0;
+
+    for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        memcpy(&block[i * 4], palette[(indices >> (i * 2)) & 3], 4);
+}
+
+// Writes one channel of a BC4 block, also used for the alpha of BC3 and both channels of BC5.
+void DecompressChannelBlock(const u8* src, u32 channel, u8 block[BLOCK_TEXEL_COUNT * 4])
+{
+    const u8 value0 = src[0];
+    const u8 value1 = src[1];
+
+    u8 palette[8];
+    palette[0] = value0;
+    palette[1] = value1;
+
+    // value0 > value1 selects the 8 value mode, otherwise 6 values plus 0 and 255.
+    if (value0 > value1)
+    {
+        for (u32 p = 2; p < 8; p++)
+            palette[p] = u8(((8 - p) * value0 + (p - 1) * value1) / 7);
+    }
+    else
+    {
+        for (u32 p = 2; p < 6; p++)
+            palette[p] = u8(((6 - p) * value0 + (p - 1) * value1) / 5);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    // 48 bits of indices, little endian.
+    u64 indices = 0;
+    memcpy(&indices, src + 2, 6);
+
+    for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        block[i * 4 + channel] = palette[(indices >> (i * 3)) & 7];
+}
+
+} // namespace
+
+bool DecompressImage(vk::Format format, const u8* blocks, u32 width, u32 height,
+                     std::vector<u8>& outRGBA)
+{
+    u32 blockSize = 0;
+    switch (format)
+    {
+    case vk::Format::eBc1RgbUnormBlock:
+    case vk::Format::eBc1RgbaUnormBlock:
+    case vk::Format::eBc4UnormBlock:
+        blockSize = 8;
+        break;
+    case vk::Format::eBc3UnormBlock:
+    case vk::Format::eBc5UnormBlock:
+        blockSize = 16;
+        break;
+    default:
+        return false;
+    }
+
+    outRGBA.resize((size_t)width * height * 4);
+
+    const u32 blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    const u32 blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+
+    u8 block[BLOCK_TEXEL_COUNT * 4];
+
+    for (u32 blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (u32 blockX = 0; blockX < blocksX; blockX++)
+        {
+            const u8* src = blocks + ((size_t)blockY * blocksX + blockX) * blockSize;
+
+            switch (format)
+            {
+            case vk::Format::eBc1RgbUnormBlock:
+                DecompressColorBlock(src, false, block);
+                // Transparent texels of BC1 without alpha are black.
+                for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+                    block[i * 4 + 3] = 255;
+                break;
+            case vk::Format::eBc1RgbaUnormBlock:
+                DecompressColorBlock(src, false, block);
+                break;
+            case vk::Format::eBc3UnormBlock:
+                DecompressColorBlock(src + 8, true, block);
+                DecompressChannelBlock(src, 3, block);
+                break;
+            default:
+                // BC4 and BC5, missing channels are 0 and alpha is 255.
+                for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+                {
+                    const u8 empty[4] = {0, 0, 0, 255};
+                    memcpy(&block[i * 4], empty, 4);
+                }
+
+                DecompressChannelBlock(src, 0, block);
+                if (format == vk::Format::eBc5UnormBlock)
+                    DecompressChannelBlock(src + 8, 1, block);
+                break;
+            }
+
+            // Blocks on the right and bottom edges may reach past the image.
+            const u32 blockWidth = std::min(BLOCK_DIMENSION, width - blockX * BLOCK_DIMENSION);
+            const u32 blockHeight = std::min(BLOCK_DIMENSION, height - blockY * BLOCK_DIMENSION);
+            for (u32 y = 0; y < blockHeight; y++)
+            {
+                const size_t dstTexel
+                    = ((size_t)blockY * BLOCK_DIMENSION + y) * width + blockX * BLOCK_DIMENSION;
+                memcpy(&outRGBA[dstTexel * 4], &block[y * BLOCK_DIMENSION * 4], blockWidth * 4);
+            }
+        }
+    }
+
+    return true;
+}
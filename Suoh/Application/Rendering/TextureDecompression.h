@@ -0,0 +1,14 @@
+#pragma once
+
+#include <RenderLib/Vulkan/VulkanCommon.h>
+
+#include <vector>
+
+/*
+ * Decompresses 4x4 blocks stored row by row into a tightly packed RGBA8 image, for devices that
+ * cannot sample block compressed images. Handles the formats SceneConverter writes (BC1, BC3 and
+ * BC5) and BC4. Channels missing from the format are 0, alpha is 255.
+ * Returns false for any other format.
+ */
+bool DecompressImage(vk::Format format, const u8* blocks, u32 width, u32 height,
+                     std::vector<u8>& outRGBA);
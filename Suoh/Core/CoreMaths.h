@@ -1,7 +1,92 @@
+#pragma once
+
 #include <cmath>
+#include <limits>
 #include <vector>
 
 #include <glm/ext.hpp>
 #include <glm/glm.hpp>
 
 #include "CoreTypes.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CORE_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+/*
+ * Minimum and maximum of count positions (3 floats each) placed stride floats apart.
+ * Strides of at least 4 floats use SSE, reading one float past every position.
+ */
+inline void MinMaxPositions(const float* data, size_t count, size_t stride, vec3& outMin,
+                            vec3& outMax)
+{
+#ifdef CORE_SIMD_SSE
+    if (stride >= 4)
+    {
+        __m128 vmin = _mm_set1_ps(std::numeric_limits<float>::max());
+        __m128 vmax = _mm_set1_ps(std::numeric_limits<float>::lowest());
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const __m128 p = _mm_loadu_ps(data + i * stride);
+            vmin = _mm_min_ps(vmin, p);
+            vmax = _mm_max_ps(vmax, p);
+        }
+
+        alignas(16) float mins[4];
+        alignas(16) float maxs[4];
+        _mm_store_ps(mins, vmin);
+        _mm_store_ps(maxs, vmax);
+
+        outMin = vec3(mins[0], mins[1], mins[2]);
+        outMax = vec3(maxs[0], maxs[1], maxs[2]);
+        return;
+    }
+#endif
+
+    vec3 vmin(std::numeric_limits<float>::max());
+    vec3 vmax(std::numeric_limits<float>::lowest());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const float* p = data + i * stride;
+        vmin = glm::min(vmin, vec3(p[0], p[1], p[2]));
+        vmax = glm::max(vmax, vec3(p[0], p[1], p[2]));
+    }
+
+    outMin = vmin;
+    outMax = vmax;
+}
+
+/*
+ * out = a * b for column major matrices. out may alias a or b.
+ */
+inline void MultiplyMat4(const mat4& a, const mat4& b, mat4& out)
+{
+#ifdef CORE_SIMD_SSE
+    const float* pa = glm::value_ptr(a);
+    const float* pb = glm::value_ptr(b);
+    float* pout = glm::value_ptr(out);
+
+    const __m128 a0 = _mm_loadu_ps(pa);
+    const __m128 a1 = _mm_loadu_ps(pa + 4);
+    const __m128 a2 = _mm_loadu_ps(pa + 8);
+    const __m128 a3 = _mm_loadu_ps(pa + 12);
+
+    // Every result column is a linear combination of the columns of a.
+    for (int c = 0; c < 4; c++)
+    {
+        const __m128 bc = _mm_loadu_ps(pb + c * 4);
+
+        __m128 r = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, _MM_SHUFFLE(3, 3, 3, 3))));
+
+        _mm_storeu_ps(pout + c * 4, r);
+    }
+#else
+    out = a * b;
+#endif
+}
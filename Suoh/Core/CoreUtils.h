@@ -1,5 +1,9 @@
 #pragma once
 
+#include "CoreTypes.h"
+
+#include <type_traits>
+
 template <typename T> inline void MergeVectors(std::vector<T>& v1, const std::vector<T>& v2)
 {
     v1.insert(v1.end(), v2.begin(), v2.end());
@@ -13,4 +17,27 @@ inline void EraseSelected(std::vector<T>& v, const std::vector<Index>& selection
             return !std::binary_search(selection.begin(), selection.end(),
                                        static_cast<Index>(static_cast<const T*>(&item) - &v[0]));
         })));
-}
\ No newline at end of file
+}
+
+constexpr u64 HASH_SEED = 0xcbf29ce484222325ull;
+
+// 64-bit FNV-1a, pass the previous result as seed to hash several ranges together.
+inline u64 HashBytes(const void* data, size_t size, u64 seed = HASH_SEED)
+{
+    const auto* bytes = static_cast<const u8*>(data);
+
+    u64 hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+template <typename T> inline u64 HashValue(const T& value, u64 seed = HASH_SEED)
+{
+    static_assert(std::is_trivially_copyable_v<T>, "HashValue requires a trivially copyable type");
+    return HashBytes(&value, sizeof(T), seed);
+}
@@ -0,0 +1,156 @@
+#include "MappedFile.h"
+
+#include "Logger.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+
+        m_Data = std::exchange(other.m_Data, nullptr);
+        m_Size = std::exchange(other.m_Size, 0);
+#ifdef _WIN32
+        m_FileHandle = std::exchange(other.m_FileHandle, nullptr);
+        m_MappingHandle = std::exchange(other.m_MappingHandle, nullptr);
+#endif
+    }
+
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        LOG_ERROR("MappedFile: failed to open ", fileName);
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        LOG_ERROR("MappedFile: file ", fileName, " is empty");
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        LOG_ERROR("MappedFile: failed to create file mapping for ", fileName);
+        CloseHandle(file);
+        return false;
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        LOG_ERROR("MappedFile: failed to map ", fileName);
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_FileHandle = file;
+    m_MappingHandle = mapping;
+    m_Data = static_cast<const u8*>(data);
+    m_Size = static_cast<u64>(size.QuadPart);
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_MappingHandle)
+        CloseHandle(m_MappingHandle);
+    if (m_FileHandle)
+        CloseHandle(m_FileHandle);
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_MappingHandle = nullptr;
+    m_FileHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    const int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("MappedFile: failed to open ", fileName);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        LOG_ERROR("MappedFile: file ", fileName, " is empty");
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        LOG_ERROR("MappedFile: failed to map ", fileName);
+        return false;
+    }
+
+    madvise(data, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    m_Data = static_cast<const u8*>(data);
+    m_Size = static_cast<u64>(st.st_size);
+
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data)
+        munmap(const_cast<u8*>(m_Data), static_cast<size_t>(m_Size));
+
+    m_Data = nullptr;
+    m_Size = 0;
+}
+
+#endif
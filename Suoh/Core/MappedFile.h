@@ -0,0 +1,48 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+#include <string>
+
+/*
+ * Read-only memory mapping of a whole file.
+ * The mapping is released when the object is destroyed.
+ */
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    NON_COPYABLE(MappedFile);
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool Open(const std::string& fileName);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return m_Data != nullptr;
+    }
+
+    const u8* GetData() const
+    {
+        return m_Data;
+    }
+
+    u64 GetSize() const
+    {
+        return m_Size;
+    }
+
+private:
+    const u8* m_Data{nullptr};
+    u64 m_Size{0};
+
+#ifdef _WIN32
+    void* m_FileHandle{nullptr};
+    void* m_MappingHandle{nullptr};
+#endif
+};
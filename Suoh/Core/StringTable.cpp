@@ -0,0 +1,163 @@
+#include "StringTable.h"
+
+#include <cstring>
+
+namespace
+{
+
+// Checks that offsets are increasing and every string is NUL terminated.
+bool ValidateStringTable(const u32* offsets, u32 count, const char* chars, u64 charCount)
+{
+    if (offsets[0] != 0 || offsets[count] != charCount)
+        return false;
+
+    for (u32 i = 0; i < count; i++)
+    {
+        if (offsets[i + 1] <= offsets[i] || chars[offsets[i + 1] - 1] != '\0')
+            return false;
+    }
+
+    return true;
+}
+
+// Splits serialized data into its offsets and chars, returns false if data is malformed.
+bool ParseStringTable(std::span<const u8> data, u32& count, const u32*& offsets,
+                      const char*& chars)
+{
+    if (data.size() < sizeof(u32))
+        return false;
+
+    memcpy(&count, data.data(), sizeof(u32));
+
+    const u64 offsetsSize = sizeof(u32) * ((u64)count + 1);
+    if (sizeof(u32) + offsetsSize > data.size())
+        return false;
+
+    offsets = reinterpret_cast<const u32*>(data.data() + sizeof(u32));
+    chars = reinterpret_cast<const char*>(data.data() + sizeof(u32) + offsetsSize);
+
+    const u64 charCount = data.size() - sizeof(u32) - offsetsSize;
+    return offsets[count] <= charCount
+           && ValidateStringTable(offsets, count, chars, offsets[count]);
+}
+
+} // namespace
+
+StringTable::StringTable(std::initializer_list<std::string_view> strings)
+{
+    for (const auto str : strings)
+        Add(str);
+}
+
+u32 StringTable::Add(std::string_view str)
+{
+    MakeOwned();
+
+    if (m_Offsets.empty())
+        m_Offsets.push_back(0);
+
+    m_Chars.insert(m_Chars.end(), str.begin(), str.end());
+    m_Chars.push_back('\0');
+    m_Offsets.push_back((u32)m_Chars.size());
+
+    return (u32)m_Count++;
+}
+
+void StringTable::Append(const StringTable& other)
+{
+    if (other.empty())
+        return;
+
+    MakeOwned();
+
+    if (m_Offsets.empty())
+        m_Offsets.push_back(0);
+
+    const u32 charOffset = (u32)m_Chars.size();
+    const u32* otherOffsets = other.GetOffsets();
+
+    m_Chars.insert(m_Chars.end(), other.GetChars(), other.GetChars() + other.GetCharCount());
+    m_Offsets.reserve(m_Offsets.size() + other.m_Count);
+    for (size_t i = 1; i <= other.m_Count; i++)
+        m_Offsets.push_back(otherOffsets[i] + charOffset);
+
+    m_Count += other.m_Count;
+}
+
+void StringTable::Reserve(size_t count, size_t charCount)
+{
+    MakeOwned();
+
+    m_Offsets.reserve(count + 1);
+    m_Chars.reserve(charCount);
+}
+
+void StringTable::Clear()
+{
+    *this = StringTable();
+}
+
+u64 StringTable::GetSerializedSize() const
+{
+    return sizeof(u32) + sizeof(u32) * ((u64)m_Count + 1) + GetCharCount();
+}
+
+void StringTable::Serialize(std::vector<u8>& out) const
+{
+    out.resize(GetSerializedSize());
+
+    const u32 count = (u32)m_Count;
+    const u32 emptyOffsets = 0;
+    const u32* offsets = m_Count ? GetOffsets() : &emptyOffsets;
+
+    u8* dst = out.data();
+    memcpy(dst, &count, sizeof(count));
+    memcpy(dst + sizeof(u32), offsets, sizeof(u32) * (m_Count + 1));
+    memcpy(dst + sizeof(u32) * (m_Count + 2), GetChars(), GetCharCount());
+}
+
+bool StringTable::Load(std::span<const u8> data)
+{
+    u32 count = 0;
+    const u32* offsets = nullptr;
+    const char* chars = nullptr;
+    if (!ParseStringTable(data, count, offsets, chars))
+        return false;
+
+    Clear();
+    m_Count = count;
+    m_Offsets.assign(offsets, offsets + count + 1);
+    m_Chars.assign(chars, chars + offsets[count]);
+
+    return true;
+}
+
+bool StringTable::View(std::span<const u8> data, std::shared_ptr<const void> owner)
+{
+    u32 count = 0;
+    const u32* offsets = nullptr;
+    const char* chars = nullptr;
+    if (!owner || !ParseStringTable(data, count, offsets, chars))
+        return false;
+
+    Clear();
+    m_Count = count;
+    m_Owner = std::move(owner);
+    m_ViewOffsets = offsets;
+    m_ViewChars = chars;
+
+    return true;
+}
+
+void StringTable::MakeOwned()
+{
+    if (!m_Owner)
+        return;
+
+    m_Offsets.assign(m_ViewOffsets, m_ViewOffsets + m_Count + 1);
+    m_Chars.assign(m_ViewChars, m_ViewChars + GetCharCount());
+
+    m_Owner.reset();
+    m_ViewOffsets = nullptr;
+    m_ViewChars = nullptr;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "CoreTypes.h"
+
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/*
+ * List of strings packed into a single NUL separated character blob plus an offsets array.
+ * Adding strings never allocates per string, and a serialized table can be viewed in place, e.g.
+ * straight out of a file mapping, without copying or allocating at all.
+ *
+ * Serialized layout:
+ *   u32 count | u32 offsets[count + 1] | chars[offsets[count]]
+ * String i starts at offsets[i] and is NUL terminated, so its length is
+ * offsets[i + 1] - offsets[i] - 1.
+ */
+class StringTable
+{
+public:
+    StringTable() = default;
+    StringTable(std::initializer_list<std::string_view> strings);
+
+    // Returns the index of the added string.
+    u32 Add(std::string_view str);
+    void Append(const StringTable& other);
+
+    void Reserve(size_t count, size_t charCount);
+    void Clear();
+
+    std::string_view operator[](size_t index) const
+    {
+        const u32* offsets = GetOffsets();
+        return {GetChars() + offsets[index], offsets[index + 1] - offsets[index] - 1};
+    }
+
+    size_t size() const
+    {
+        return m_Count;
+    }
+
+    bool empty() const
+    {
+        return m_Count == 0;
+    }
+
+    // Characters of all strings including their NUL terminators.
+    u32 GetCharCount() const
+    {
+        return m_Count ? GetOffsets()[m_Count] : 0;
+    }
+
+    // Size of the serialized table in bytes.
+    u64 GetSerializedSize() const;
+    void Serialize(std::vector<u8>& out) const;
+
+    // Copies a serialized table.
+    bool Load(std::span<const u8> data);
+
+    /*
+     * References a serialized table without copying it. owner keeps the memory behind data alive,
+     * the table falls back to an owned copy as soon as strings are added.
+     */
+    bool View(std::span<const u8> data, std::shared_ptr<const void> owner);
+
+private:
+    const char* GetChars() const
+    {
+        return m_Owner ? m_ViewChars : m_Chars.data();
+    }
+
+    const u32* GetOffsets() const
+    {
+        return m_Owner ? m_ViewOffsets : m_Offsets.data();
+    }
+
+    void MakeOwned();
+
+    std::vector<char> m_Chars;
+    std::vector<u32> m_Offsets;
+    size_t m_Count{0};
+
+    // Set while viewing memory owned by someone else.
+    std::shared_ptr<const void> m_Owner;
+    const char* m_ViewChars{nullptr};
+    const u32* m_ViewOffsets{nullptr};
+};
@@ -0,0 +1,570 @@
+#include "BVH.h"
+
+#include <CoreMaths.h>
+
+#include <algorithm>
+#include <execution>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+
+constexpr size_t PARALLEL_BOUNDS_THRESHOLD = 1024;
+
+enum class FrustumOverlap
+{
+    OUTSIDE,
+    INTERSECTS,
+    INSIDE,
+};
+
+// Items are partitioned together with their bounds, so building reads memory linearly.
+struct BuildItem
+{
+    BoundingBox bounds;
+    vec3 centroid;
+    u32 item;
+};
+
+struct SAHBin
+{
+    BoundingBox bounds;
+    u32 count{0};
+};
+
+// Pending node of a ray or nearest query, distance is the distance to its bounds.
+struct QueryEntry
+{
+    u32 node;
+    float distance;
+};
+
+BoundingBox EmptyBounds()
+{
+    BoundingBox b;
+    b.min = vec3(std::numeric_limits<float>::max());
+    b.max = vec3(std::numeric_limits<float>::lowest());
+    return b;
+}
+
+float SurfaceArea(const BoundingBox& b)
+{
+    const vec3 d = glm::max(b.max - b.min, vec3(0.0f));
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool IsLeaf(const BVHNode& node)
+{
+    return node.firstChild == u32(-1);
+}
+
+BoundingBox GetItemRangeBounds(const BVH& bvh, u32 firstItem, u32 itemCount)
+{
+    BoundingBox bounds = EmptyBounds();
+    for (u32 i = firstItem; i < firstItem + itemCount; i++)
+        bounds.CombineBox(bvh.itemBounds[bvh.items[i]]);
+
+    return bounds;
+}
+
+BoundingBox GetBuildRangeBounds(const std::vector<BuildItem>& buildItems, u32 firstItem,
+                                u32 itemCount)
+{
+    BoundingBox bounds = EmptyBounds();
+    for (u32 i = firstItem; i < firstItem + itemCount; i++)
+        bounds.CombineBox(buildItems[i].bounds);
+
+    return bounds;
+}
+
+/*
+ * Partitions the items of node along the cheapest binned SAH split.
+ * Returns the number of items that go to the first child.
+ */
+u32 SplitItems(std::vector<BuildItem>& buildItems, const BVHNode& node)
+{
+    const auto first = buildItems.begin() + node.firstItem;
+    const auto last = first + node.itemCount;
+
+    BoundingBox centroidBounds = EmptyBounds();
+    for (auto it = first; it != last; ++it)
+        centroidBounds.CombinePoint(it->centroid);
+
+    const vec3 extent = centroidBounds.GetSize();
+    vec3 scale(0.0f);
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        if (extent[axis] > 0.0f)
+            scale[axis] = BVH_SAH_BIN_COUNT / extent[axis];
+    }
+
+    auto getBin = [&](const BuildItem& item, u32 axis) {
+        const float offset = (item.centroid[axis] - centroidBounds.min[axis]) * scale[axis];
+        return std::min((u32)offset, BVH_SAH_BIN_COUNT - 1);
+    };
+
+    SAHBin bins[3][BVH_SAH_BIN_COUNT];
+    for (auto& axisBins : bins)
+    {
+        for (auto& bin : axisBins)
+            bin.bounds = EmptyBounds();
+    }
+
+    for (auto it = first; it != last; ++it)
+    {
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+            SAHBin& bin = bins[axis][getBin(*it, axis)];
+            bin.bounds.CombineBox(it->bounds);
+            bin.count++;
+        }
+    }
+
+    float bestCost = std::numeric_limits<float>::max();
+    u32 bestAxis = 0;
+    u32 bestBin = 0;
+
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+        if (extent[axis] <= 0.0f)
+            continue;
+
+        // Cost of the bins at and after every split.
+        float rightCosts[BVH_SAH_BIN_COUNT];
+        BoundingBox right = EmptyBounds();
+        u32 rightCount = 0;
+        for (u32 b = BVH_SAH_BIN_COUNT - 1; b > 0; b--)
+        {
+            right.CombineBox(bins[axis][b].bounds);
+            rightCount += bins[axis][b].count;
+            rightCosts[b] = SurfaceArea(right) * rightCount;
+        }
+
+        BoundingBox left = EmptyBounds();
+        u32 leftCount = 0;
+        for (u32 b = 1; b < BVH_SAH_BIN_COUNT; b++)
+        {
+            left.CombineBox(bins[axis][b - 1].bounds);
+            leftCount += bins[axis][b - 1].count;
+            if (leftCount == 0 || leftCount == node.itemCount)
+                continue;
+
+            const float cost = SurfaceArea(left) * leftCount + rightCosts[b];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    // All centroids fall into one bin, split the range in the middle instead.
+    if (bestCost == std::numeric_limits<float>::max())
+        return node.itemCount / 2;
+
+    const auto middle = std::partition(
+        first, last, [&](const BuildItem& item) { return getBin(item, bestAxis) < bestBin; });
+
+    return (u32)(middle - first);
+}
+
+// Frustum planes prepared once per query for TestFrustumBounds.
+struct FrustumTest
+{
+#ifdef CORE_SIMD_SSE
+    // Planes transposed into two groups of four, the second one repeats the near and far planes.
+    __m128 normalX[2], normalY[2], normalZ[2], distance[2];
+    __m128 absNormalX[2], absNormalY[2], absNormalZ[2];
+#else
+    vec4 planes[6];
+#endif
+};
+
+FrustumTest MakeFrustumTest(const vec4 planes[6])
+{
+    FrustumTest test;
+
+#ifdef CORE_SIMD_SSE
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (u32 g = 0; g < 2; g++)
+    {
+        const vec4& p0 = planes[g * 4 + 0];
+        const vec4& p1 = planes[g * 4 + 1];
+        const vec4& p2 = planes[g ? 4 : 2];
+        const vec4& p3 = planes[g ? 5 : 3];
+
+        test.normalX[g] = _mm_setr_ps(p0.x, p1.x, p2.x, p3.x);
+        test.normalY[g] = _mm_setr_ps(p0.y, p1.y, p2.y, p3.y);
+        test.normalZ[g] = _mm_setr_ps(p0.z, p1.z, p2.z, p3.z);
+        test.distance[g] = _mm_setr_ps(p0.w, p1.w, p2.w, p3.w);
+
+        test.absNormalX[g] = _mm_andnot_ps(signMask, test.normalX[g]);
+        test.absNormalY[g] = _mm_andnot_ps(signMask, test.normalY[g]);
+        test.absNormalZ[g] = _mm_andnot_ps(signMask, test.normalZ[g]);
+    }
+#else
+    std::copy(planes, planes + 6, test.planes);
+#endif
+
+    return test;
+}
+
+FrustumOverlap TestFrustumBounds(const FrustumTest& test, const BoundingBox& b)
+{
+#ifdef CORE_SIMD_SSE
+    const vec3 center = b.GetCenter();
+    const vec3 extent = b.max - center;
+
+    const __m128 cx = _mm_set1_ps(center.x);
+    const __m128 cy = _mm_set1_ps(center.y);
+    const __m128 cz = _mm_set1_ps(center.z);
+    const __m128 ex = _mm_set1_ps(extent.x);
+    const __m128 ey = _mm_set1_ps(extent.y);
+    const __m128 ez = _mm_set1_ps(extent.z);
+
+    // Outside a plane if the center is further behind it than the extent reaches, crossing it if
+    // the extent reaches behind it.
+    int outside = 0;
+    int crossing = 0;
+    for (u32 g = 0; g < 2; g++)
+    {
+        __m128 d = _mm_add_ps(_mm_mul_ps(test.normalX[g], cx), test.distance[g]);
+        d = _mm_add_ps(d, _mm_mul_ps(test.normalY[g], cy));
+        d = _mm_add_ps(d, _mm_mul_ps(test.normalZ[g], cz));
+
+        __m128 r = _mm_mul_ps(test.absNormalX[g], ex);
+        r = _mm_add_ps(r, _mm_mul_ps(test.absNormalY[g], ey));
+        r = _mm_add_ps(r, _mm_mul_ps(test.absNormalZ[g], ez));
+
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+        crossing |= _mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(d, r), _mm_setzero_ps()));
+    }
+
+    if (outside != 0)
+        return FrustumOverlap::OUTSIDE;
+
+    return crossing != 0 ? FrustumOverlap::INTERSECTS : FrustumOverlap::INSIDE;
+#else
+    FrustumOverlap overlap = FrustumOverlap::INSIDE;
+
+    for (u32 i = 0; i < 6; i++)
+    {
+        const vec4& plane = test.planes[i];
+        const vec3 normal(plane);
+
+        // Corners furthest along and against the plane normal.
+        const vec3 positive(normal.x >= 0.0f ? b.max.x : b.min.x,
+                            normal.y >= 0.0f ? b.max.y : b.min.y,
+                            normal.z >= 0.0f ? b.max.z : b.min.z);
+        const vec3 negative(normal.x >= 0.0f ? b.min.x : b.max.x,
+                            normal.y >= 0.0f ? b.min.y : b.max.y,
+                            normal.z >= 0.0f ? b.min.z : b.max.z);
+
+        if (glm::dot(normal, positive) + plane.w < 0.0f)
+            return FrustumOverlap::OUTSIDE;
+
+        if (glm::dot(normal, negative) + plane.w < 0.0f)
+            overlap = FrustumOverlap::INTERSECTS;
+    }
+
+    return overlap;
+#endif
+}
+
+// Returns false if the ray misses b before maxDistance, outDistance is the entry distance.
+bool IntersectRayBounds(const BoundingBox& b, const vec3& origin, const vec3& invDirection,
+                        float maxDistance, float& outDistance)
+{
+    const vec3 t0 = (b.min - origin) * invDirection;
+    const vec3 t1 = (b.max - origin) * invDirection;
+    const vec3 tMin = glm::min(t0, t1);
+    const vec3 tMax = glm::max(t0, t1);
+
+    const float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+    const float exit = std::min(std::min(tMax.x, tMax.y), std::min(tMax.z, maxDistance));
+
+    outDistance = enter;
+    return enter <= exit;
+}
+
+float GetBoundsDistance(const BoundingBox& b, const vec3& point)
+{
+    const vec3 d = glm::max(glm::max(b.min - point, point - b.max), vec3(0.0f));
+    return glm::length(d);
+}
+
+} // namespace
+
+void ComputeShapeBounds(const Scene& scene, std::span<const DrawData> shapes,
+                        std::span<const BoundingBox> meshBounds,
+                        std::vector<BoundingBox>& outBounds)
+{
+    outBounds.resize(shapes.size());
+
+    auto transform = [&scene, &meshBounds](const DrawData& shape) {
+        return meshBounds[shape.meshIndex].GetTransformed(
+            scene.globalTransforms[shape.transformIndex]);
+    };
+
+    if (shapes.size() >= PARALLEL_BOUNDS_THRESHOLD)
+        std::transform(std::execution::par, shapes.begin(), shapes.end(), outBounds.begin(),
+                       transform);
+    else
+        std::transform(shapes.begin(), shapes.end(), outBounds.begin(), transform);
+}
+
+void BuildBVH(BVH& bvh, std::span<const BoundingBox> itemBounds)
+{
+    const u32 itemCount = (u32)itemBounds.size();
+
+    bvh.nodes.clear();
+    bvh.itemBounds.assign(itemBounds.begin(), itemBounds.end());
+    bvh.items.resize(itemCount);
+
+    if (itemCount == 0)
+        return;
+
+    std::vector<BuildItem> buildItems(itemCount);
+    for (u32 i = 0; i < itemCount; i++)
+        buildItems[i] = {itemBounds[i], itemBounds[i].GetCenter(), i};
+
+    // A binary tree with single item leaves has 2n - 1 nodes.
+    bvh.nodes.reserve(2 * (size_t)itemCount - 1);
+    bvh.nodes.push_back(BVHNode{
+        .bounds = GetBuildRangeBounds(buildItems, 0, itemCount),
+        .firstItem = 0,
+        .itemCount = itemCount,
+    });
+
+    std::vector<u32> stack{0};
+    while (!stack.empty())
+    {
+        const u32 nodeIndex = stack.back();
+        stack.pop_back();
+
+        // Copied, adding children may reallocate nodes.
+        const BVHNode node = bvh.nodes[nodeIndex];
+        if (node.itemCount <= BVH_MAX_LEAF_ITEMS)
+            continue;
+
+        const u32 leftCount = SplitItems(buildItems, node);
+        const u32 rightCount = node.itemCount - leftCount;
+        const u32 firstChild = (u32)bvh.nodes.size();
+
+        bvh.nodes[nodeIndex].firstChild = firstChild;
+        bvh.nodes.push_back(BVHNode{
+            .bounds = GetBuildRangeBounds(buildItems, node.firstItem, leftCount),
+            .firstItem = node.firstItem,
+            .itemCount = leftCount,
+        });
+        bvh.nodes.push_back(BVHNode{
+            .bounds = GetBuildRangeBounds(buildItems, node.firstItem + leftCount, rightCount),
+            .firstItem = node.firstItem + leftCount,
+            .itemCount = rightCount,
+        });
+
+        stack.push_back(firstChild);
+        stack.push_back(firstChild + 1);
+    }
+
+    std::transform(buildItems.begin(), buildItems.end(), bvh.items.begin(),
+                   [](const BuildItem& item) { return item.item; });
+}
+
+void RefitBVH(BVH& bvh, std::span<const BoundingBox> itemBounds)
+{
+    if (itemBounds.size() != bvh.items.size())
+    {
+        BuildBVH(bvh, itemBounds);
+        return;
+    }
+
+    bvh.itemBounds.assign(itemBounds.begin(), itemBounds.end());
+
+    // Children come after their parent, so walking backwards visits them first.
+    for (size_t i = bvh.nodes.size(); i-- > 0;)
+    {
+        BVHNode& node = bvh.nodes[i];
+        if (IsLeaf(node))
+        {
+            node.bounds = GetItemRangeBounds(bvh, node.firstItem, node.itemCount);
+        }
+        else
+        {
+            node.bounds = bvh.nodes[node.firstChild].bounds;
+            node.bounds.CombineBox(bvh.nodes[node.firstChild + 1].bounds);
+        }
+    }
+}
+
+void GetFrustumPlanes(const mat4& viewProj, vec4 planes[6])
+{
+    const mat4 m = glm::transpose(viewProj);
+
+    planes[0] = m[3] + m[0];
+    planes[1] = m[3] - m[0];
+    planes[2] = m[3] + m[1];
+    planes[3] = m[3] - m[1];
+    planes[4] = m[3] + m[2];
+    planes[5] = m[3] - m[2];
+
+    for (u32 i = 0; i < 6; i++)
+        planes[i] /= glm::length(vec3(planes[i]));
+}
+
+void QueryBVHFrustum(const BVH& bvh, const vec4 planes[6], std::vector<u32>& outItems)
+{
+    if (bvh.nodes.empty())
+        return;
+
+    const FrustumTest test = MakeFrustumTest(planes);
+
+    std::vector<u32> stack{0};
+    while (!stack.empty())
+    {
+        const BVHNode& node = bvh.nodes[stack.back()];
+        stack.pop_back();
+
+        const FrustumOverlap overlap = TestFrustumBounds(test, node.bounds);
+        if (overlap == FrustumOverlap::OUTSIDE)
+            continue;
+
+        const auto first = bvh.items.begin() + node.firstItem;
+        if (overlap == FrustumOverlap::INSIDE)
+        {
+            outItems.insert(outItems.end(), first, first + node.itemCount);
+        }
+        else if (IsLeaf(node))
+        {
+            for (auto it = first; it != first + node.itemCount; ++it)
+            {
+                if (TestFrustumBounds(test, bvh.itemBounds[*it]) != FrustumOverlap::OUTSIDE)
+                    outItems.push_back(*it);
+            }
+        }
+        else
+        {
+            stack.push_back(node.firstChild);
+            stack.push_back(node.firstChild + 1);
+        }
+    }
+}
+
+u32 RaycastBVH(const BVH& bvh, const vec3& origin, const vec3& direction, float maxDistance,
+               float& outDistance)
+{
+    u32 result = u32(-1);
+    float bestDistance = maxDistance;
+
+    const vec3 invDirection = 1.0f / direction;
+
+    float distance = 0.0f;
+    if (bvh.nodes.empty()
+        || !IntersectRayBounds(bvh.nodes[0].bounds, origin, invDirection, bestDistance, distance))
+        return result;
+
+    std::vector<QueryEntry> stack{{0, distance}};
+    while (!stack.empty())
+    {
+        const QueryEntry entry = stack.back();
+        stack.pop_back();
+
+        if (entry.distance > bestDistance)
+            continue;
+
+        const BVHNode& node = bvh.nodes[entry.node];
+        if (IsLeaf(node))
+        {
+            for (u32 i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+            {
+                const u32 item = bvh.items[i];
+                if (IntersectRayBounds(bvh.itemBounds[item], origin, invDirection, bestDistance,
+                                       distance)
+                    && (result == u32(-1) || distance < bestDistance))
+                {
+                    result = item;
+                    bestDistance = distance;
+                }
+            }
+            continue;
+        }
+
+        // Push the nearer child last so it is visited first.
+        QueryEntry children[2];
+        u32 hitCount = 0;
+        for (u32 c = 0; c < 2; c++)
+        {
+            const u32 child = node.firstChild + c;
+            if (IntersectRayBounds(bvh.nodes[child].bounds, origin, invDirection, bestDistance,
+                                   distance))
+                children[hitCount++] = {child, distance};
+        }
+
+        if (hitCount == 2 && children[0].distance < children[1].distance)
+            std::swap(children[0], children[1]);
+
+        stack.insert(stack.end(), children, children + hitCount);
+    }
+
+    if (result != u32(-1))
+        outDistance = bestDistance;
+
+    return result;
+}
+
+u32 FindNearestBVHItem(const BVH& bvh, const vec3& point, float maxDistance, float& outDistance)
+{
+    u32 result = u32(-1);
+    float bestDistance = maxDistance;
+
+    if (bvh.nodes.empty())
+        return result;
+
+    std::vector<QueryEntry> stack{{0, GetBoundsDistance(bvh.nodes[0].bounds, point)}};
+    while (!stack.empty())
+    {
+        const QueryEntry entry = stack.back();
+        stack.pop_back();
+
+        if (entry.distance > bestDistance)
+            continue;
+
+        const BVHNode& node = bvh.nodes[entry.node];
+        if (IsLeaf(node))
+        {
+            for (u32 i = node.firstItem; i < node.firstItem + node.itemCount; i++)
+            {
+                const u32 item = bvh.items[i];
+                const float distance = GetBoundsDistance(bvh.itemBounds[item], point);
+                if (distance <= bestDistance && (result == u32(-1) || distance < bestDistance))
+                {
+                    result = item;
+                    bestDistance = distance;
+                }
+            }
+            continue;
+        }
+
+        QueryEntry children[2] = {
+            {node.firstChild, GetBoundsDistance(bvh.nodes[node.firstChild].bounds, point)},
+            {node.firstChild + 1, GetBoundsDistance(bvh.nodes[node.firstChild + 1].bounds, point)},
+        };
+
+        if (children[0].distance < children[1].distance)
+            std::swap(children[0], children[1]);
+
+        for (const auto& child : children)
+        {
+            if (child.distance <= bestDistance)
+                stack.push_back(child);
+        }
+    }
+
+    if (result != u32(-1))
+        outDistance = bestDistance;
+
+    return result;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <CoreTypes.h>
+
+#include "BoundingBox.h"
+#include "Mesh.h"
+#include "Scene.h"
+
+#include <span>
+#include <vector>
+
+constexpr u32 BVH_MAX_LEAF_ITEMS = 4;
+constexpr u32 BVH_SAH_BIN_COUNT = 16;
+
+struct BVHNode
+{
+    BoundingBox bounds;
+
+    // Range of BVH::items below this node, leaves and inner nodes alike.
+    u32 firstItem{0};
+    u32 itemCount{0};
+
+    // Both children are stored next to each other, u32(-1) for leaves.
+    u32 firstChild{u32(-1)};
+};
+
+/*
+ * World space bounding volume hierarchy over items, usually one per shape.
+ * Built top down with a binned surface area heuristic. When items move, RefitBVH updates the node
+ * bounds but keeps the tree, so rebuild it after large changes to keep queries fast.
+ */
+struct BVH
+{
+    // nodes[0] is the root, children always come after their parent.
+    std::vector<BVHNode> nodes;
+
+    // Item indices in tree order, every node covers a contiguous range.
+    std::vector<u32> items;
+
+    // World space bounds, indexed by item.
+    std::vector<BoundingBox> itemBounds;
+};
+
+/*
+ * World space bounds of every shape: the bounds of its mesh moved by the global transform of its
+ * node.
+ */
+void ComputeShapeBounds(const Scene& scene, std::span<const DrawData> shapes,
+                        std::span<const BoundingBox> meshBounds,
+                        std::vector<BoundingBox>& outBounds);
+
+void BuildBVH(BVH& bvh, std::span<const BoundingBox> itemBounds);
+
+/*
+ * Updates the bounds of items and nodes in place. Rebuilds the tree instead if the item count
+ * changed.
+ */
+void RefitBVH(BVH& bvh, std::span<const BoundingBox> itemBounds);
+
+/*
+ * Inward facing planes (xyz normal, w distance) of the frustum of a view projection matrix, in the
+ * order left, right, bottom, top, near, far.
+ */
+void GetFrustumPlanes(const mat4& viewProj, vec4 planes[6]);
+
+/*
+ * Appends every item whose bounds intersect the frustum. Nodes and items are tested against four
+ * planes at once where SSE is available.
+ */
+void QueryBVHFrustum(const BVH& bvh, const vec4 planes[6], std::vector<u32>& outItems);
+
+/*
+ * Returns the item whose bounds are entered first along the ray, or u32(-1). outDistance is set to
+ * the distance along direction, 0 when origin is inside the bounds.
+ */
+u32 RaycastBVH(const BVH& bvh, const vec3& origin, const vec3& direction, float maxDistance,
+               float& outDistance);
+
+// Returns the item whose bounds are closest to point within maxDistance, or u32(-1).
+u32 FindNearestBVHItem(const BVH& bvh, const vec3& point, float maxDistance, float& outDistance);
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <CoreTypes.h>
 
 #include <cmath>
@@ -66,4 +68,10 @@ struct BoundingBox
         min = glm::min(min, p);
         max = glm::max(max, p);
     }
+
+    void CombineBox(const BoundingBox& b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
 };
\ No newline at end of file
@@ -26,7 +26,7 @@ bool SaveMaterials(const std::string& fileName, const std::vector<MaterialDescri
 }
 
 bool LoadMaterials(const std::string& fileName, std::vector<MaterialDescription>& materials,
-                   std::vector<std::string>& files)
+                   StringTable& files)
 {
     std::ifstream file(fileName, std::ios::out | std::ios::binary);
     if (!file)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <CoreTypes.h>
+#include <StringTable.h>
 
 #include <string>
 #include <vector>
@@ -45,7 +46,7 @@ static_assert(sizeof(MaterialDescription) % 16 == 0,
 bool SaveMaterials(const std::string& fileName, const std::vector<MaterialDescription>& materials,
                    const std::vector<std::string>& files);
 bool LoadMaterials(const std::string& fileName, std::vector<MaterialDescription>& materials,
-                   std::vector<std::string>& files);
+                   StringTable& files);
 
 // XXX: Need to handle case where merged texture array size exceeds device shader limits.
 void MergeMaterialLists(std::vector<MaterialDescription>& dstMaterials,
@@ -1,13 +1,43 @@
 #include "Mesh.h"
 
+#include "MeshCompression.h"
+
+#include <CoreMaths.h>
 #include <Logger.h>
 
+#include <algorithm>
+#include <cstring>
+#include <execution>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iterator>
+#include <numeric>
 
 namespace fs = std::filesystem;
 
-static constexpr auto MESH_HEADER_MAGIC_NUMBER = 0x12345678;
+static constexpr u32 MESH_FILE_MAGIC_NUMBER = 0x4853454D; // "MESH"
+static constexpr u32 LEGACY_MESH_FILE_MAGIC_NUMBER = 0x12345678;
+
+namespace
+{
+
+constexpr size_t PARALLEL_LOD_THRESHOLD = 1024;
+
+struct MeshFileSectionData
+{
+    MeshFileSectionType type;
+    u32 elementSize;
+    const void* data;
+    u64 size;
+};
+
+inline u64 AlignFileOffset(u64 offset)
+{
+    return (offset + MESH_FILE_SECTION_ALIGNMENT - 1) & ~(MESH_FILE_SECTION_ALIGNMENT - 1);
+}
+
+} // namespace
 
 std::vector<DrawData> CreateMeshDrawData(const MeshData& meshData)
 {
@@ -33,30 +63,105 @@ std::vector<DrawData> CreateMeshDrawData(const MeshData& meshData)
     return drawData;
 }
 
-void RecalculateBoundingBoxes(MeshData& meshData)
+namespace
+{
+
+// Returns whether the LOD of shape changed.
+bool SelectDrawDataLOD(DrawData& shape, const BoundingBox& bounds, std::span<const Mesh> meshes,
+                       const vec3& cameraPosition, float tanHalfFovY)
 {
-    meshData.boundingBoxes.clear();
+    const u32 lodCount = std::max(meshes[shape.meshIndex].lodCount, 1u);
 
-    for (const auto& mesh : meshData.meshes)
+    const float radius = 0.5f * glm::length(bounds.GetSize());
+    const float distance = glm::length(bounds.GetCenter() - cameraPosition);
+
+    // Continuous LOD, stays at 0 while the camera is inside the bounds.
+    float lod = 0.0f;
+    if (distance > radius)
     {
-        const auto numIndices = mesh.GetLODIndicesCount(0);
+        const float screenSize = radius / (distance * tanHalfFovY);
+        lod = std::log2(LOD_FULL_DETAIL_SCREEN_SIZE / screenSize);
+    }
 
-        vec3 vmin(std::numeric_limits<float>::max());
-        vec3 vmax(std::numeric_limits<float>::lowest());
+    const float current = (float)shape.LOD;
+    if (lod > current - LOD_HYSTERESIS && lod < current + 1.0f + LOD_HYSTERESIS)
+        return false;
 
-        for (auto i = 0; i != numIndices; i++)
-        {
-            auto vtxOffset = meshData.indexData[mesh.indexOffset + i] + mesh.vertexOffset;
-            const float* vf = &meshData.vertexData[vtxOffset * MAX_STREAMS];
-            vmin = glm::min(vmin, vec3(vf[0], vf[1], vf[2]));
-            vmax = glm::max(vmax, vec3(vf[0], vf[1], vf[2]));
-        }
+    const u32 newLod = std::min((u32)std::max(lod, 0.0f), lodCount - 1);
+    if (newLod == shape.LOD)
+        return false;
 
-        meshData.boundingBoxes.emplace_back(vmin, vmax);
-    }
+    shape.LOD = newLod;
+    return true;
+}
+
+// Calls select(i) for every i below count, in parallel chunks for large counts.
+template <typename SelectFunc> u32 SelectLODsChunked(size_t count, SelectFunc select)
+{
+    auto selectRange = [&](size_t first, size_t last) {
+        u32 changedCount = 0;
+        for (size_t i = first; i < last; i++)
+            changedCount += select(i) ? 1 : 0;
+        return changedCount;
+    };
+
+    if (count < PARALLEL_LOD_THRESHOLD)
+        return selectRange(0, count);
+
+    std::vector<size_t> chunks((count + PARALLEL_LOD_THRESHOLD - 1) / PARALLEL_LOD_THRESHOLD);
+    std::iota(chunks.begin(), chunks.end(), 0);
+
+    return std::transform_reduce(
+        std::execution::par, chunks.begin(), chunks.end(), 0u, std::plus<>(), [&](size_t chunk) {
+            const size_t first = chunk * PARALLEL_LOD_THRESHOLD;
+            return selectRange(first, std::min(first + PARALLEL_LOD_THRESHOLD, count));
+        });
+}
+
+} // namespace
+
+u32 SelectDrawDataLODs(std::span<DrawData> shapes, std::span<const BoundingBox> shapeBounds,
+                       std::span<const Mesh> meshes, const vec3& cameraPosition,
+                       float tanHalfFovY)
+{
+    return SelectLODsChunked(shapes.size(), [&](size_t i) {
+        return SelectDrawDataLOD(shapes[i], shapeBounds[i], meshes, cameraPosition, tanHalfFovY);
+    });
+}
+
+u32 SelectDrawDataLODs(std::span<DrawData> shapes, std::span<const u32> shapeIndices,
+                       std::span<const BoundingBox> shapeBounds, std::span<const Mesh> meshes,
+                       const vec3& cameraPosition, float tanHalfFovY)
+{
+    return SelectLODsChunked(shapeIndices.size(), [&](size_t i) {
+        const u32 shape = shapeIndices[i];
+        return SelectDrawDataLOD(shapes[shape], shapeBounds[shape], meshes, cameraPosition,
+                                 tanHalfFovY);
+    });
+}
+
+void RecalculateBoundingBoxes(MeshData& meshData)
+{
+    meshData.boundingBoxes.resize(meshData.meshes.size());
+
+    // Bounds cover the vertex range of every mesh, which LOD0 references entirely.
+    std::transform(std::execution::par, meshData.meshes.begin(), meshData.meshes.end(),
+                   meshData.boundingBoxes.begin(), [&meshData](const Mesh& mesh) {
+                       const size_t stride = mesh.streamElementSize[0]
+                                                 ? mesh.streamElementSize[0] / sizeof(float)
+                                                 : MESH_VERTEX_FLOAT_COUNT;
+                       const float* positions
+                           = meshData.vertexData.data() + (size_t)mesh.vertexOffset * stride;
+
+                       vec3 vmin;
+                       vec3 vmax;
+                       MinMaxPositions(positions, mesh.vertexCount, stride, vmin, vmax);
+
+                       return BoundingBox(vmin, vmax);
+                   });
 }
 
-bool SaveMeshData(const std::string& fileName, const MeshData& meshData)
+bool SaveMeshData(const std::string& fileName, const MeshData& meshData, bool encodeStreams)
 {
     std::ofstream outFile(fileName, std::ios::out | std::ios::binary);
     if (!outFile)
@@ -65,23 +170,91 @@ bool SaveMeshData(const std::string& fileName, const MeshData& meshData)
         return false;
     }
 
+    std::vector<MeshFileSectionData> sectionData = {
+        {MeshFileSectionType::MESHES, sizeof(Mesh), meshData.meshes.data(),
+         meshData.meshes.size() * sizeof(Mesh)},
+        {MeshFileSectionType::BOUNDING_BOXES, sizeof(BoundingBox), meshData.boundingBoxes.data(),
+         meshData.boundingBoxes.size() * sizeof(BoundingBox)},
+    };
+
+    EncodedMeshStreams encodedStreams;
+    if (encodeStreams && !EncodeMeshStreams(meshData, encodedStreams))
+    {
+        LOG_WARN("SaveMeshData: failed to encode mesh streams, saving them uncompressed");
+        encodeStreams = false;
+    }
+
+    if (encodeStreams)
+    {
+        sectionData.push_back({MeshFileSectionType::ENCODED_RANGES, sizeof(MeshFileEncodedRange),
+                               encodedStreams.ranges.data(),
+                               encodedStreams.ranges.size() * sizeof(MeshFileEncodedRange)});
+        sectionData.push_back({MeshFileSectionType::ENCODED_INDEX_DATA, sizeof(u8),
+                               encodedStreams.indexData.data(), encodedStreams.indexData.size()});
+        sectionData.push_back({MeshFileSectionType::ENCODED_VERTEX_DATA, sizeof(u8),
+                               encodedStreams.vertexData.data(),
+                               encodedStreams.vertexData.size()});
+    }
+    else
+    {
+        sectionData.push_back({MeshFileSectionType::INDEX_DATA, sizeof(u32),
+                               meshData.indexData.data(), meshData.indexData.size() * sizeof(u32)});
+        sectionData.push_back({MeshFileSectionType::VERTEX_DATA, sizeof(float),
+                               meshData.vertexData.data(),
+                               meshData.vertexData.size() * sizeof(float)});
+    }
+
+    const u32 sectionCount = (u32)sectionData.size();
+
     const MeshFileHeader header = {
-        .magicNumber = MESH_HEADER_MAGIC_NUMBER,
+        .magicNumber = MESH_FILE_MAGIC_NUMBER,
+        .version = MESH_FILE_VERSION,
         .meshCount = (u32)meshData.meshes.size(),
-        .vertexDataSize = (u32)(meshData.vertexData.size() * sizeof(float)),
-        .indexDataSize = (u32)(meshData.indexData.size() * sizeof(u32)),
-        .dataBlockStartOffset
-        = (u32)(sizeof(MeshFileHeader) + meshData.meshes.size() * sizeof(Mesh)),
+        .sectionCount = sectionCount,
+        .indexDataSize = meshData.indexData.size() * sizeof(u32),
+        .vertexDataSize = meshData.vertexData.size() * sizeof(float),
+        .sectionTableOffset = sizeof(MeshFileHeader),
     };
 
+    std::vector<MeshFileSection> sections(sectionCount);
+    u64 offset
+        = AlignFileOffset(header.sectionTableOffset + sizeof(MeshFileSection) * sectionCount);
+    for (u32 i = 0; i < sectionCount; i++)
+    {
+        sections[i] = {
+            .type = sectionData[i].type,
+            .elementSize = sectionData[i].elementSize,
+            .offset = offset,
+            .size = sectionData[i].size,
+        };
+        offset = AlignFileOffset(offset + sectionData[i].size);
+    }
+
     LOG_INFO("save MeshData indexDataSize: ", header.indexDataSize);
     LOG_INFO("save MeshData vertexDataSize: ", header.vertexDataSize);
+    if (encodeStreams)
+    {
+        LOG_INFO("save MeshData encoded index/vertex size: ", encodedStreams.indexData.size(), "/",
+                 encodedStreams.vertexData.size());
+    }
 
     outFile.write((char*)&header, sizeof(header));
-    outFile.write((char*)meshData.meshes.data(), sizeof(Mesh) * header.meshCount);
-    outFile.write((char*)meshData.boundingBoxes.data(), sizeof(BoundingBox) * header.meshCount);
-    outFile.write((char*)meshData.indexData.data(), header.indexDataSize);
-    outFile.write((char*)meshData.vertexData.data(), header.vertexDataSize);
+    outFile.write((char*)sections.data(), sizeof(MeshFileSection) * sectionCount);
+
+    u64 position = sizeof(header) + sizeof(MeshFileSection) * sectionCount;
+    const char padding[MESH_FILE_SECTION_ALIGNMENT]{};
+    for (u32 i = 0; i < sectionCount; i++)
+    {
+        outFile.write(padding, sections[i].offset - position);
+        outFile.write((const char*)sectionData[i].data, sections[i].size);
+        position = sections[i].offset + sections[i].size;
+    }
+
+    if (!outFile.good())
+    {
+        LOG_ERROR("SaveMeshData: failed to write mesh data ", fileName);
+        return false;
+    }
 
     outFile.close();
 
@@ -105,57 +278,247 @@ bool SaveDrawData(const std::string& fileName, const std::vector<DrawData>& draw
 
 MeshFileHeader LoadMeshData(const std::string& fileName, MeshData& meshData)
 {
-    MeshFileHeader header;
-    header.meshCount = 0;
+    // Parse through a mapping and copy each section once, instead of zero filling the vectors
+    // and reading into them.
+    MappedMeshData mappedData;
+    auto header = LoadMeshData(fileName, mappedData);
+    if (header.meshCount == 0)
+        return header;
 
-    std::ifstream inFile(fileName, std::ios::out | std::ios::binary);
-    if (!inFile)
+    meshData.meshes.assign(mappedData.meshes.begin(), mappedData.meshes.end());
+    meshData.boundingBoxes.assign(mappedData.boundingBoxes.begin(),
+                                  mappedData.boundingBoxes.end());
+    meshData.indexData.assign(mappedData.indexData.begin(), mappedData.indexData.end());
+    meshData.vertexData.assign(mappedData.vertexData.begin(), mappedData.vertexData.end());
+
+    return header;
+}
+
+namespace
+{
+
+// Written as size <= fileSize - offset so crafted offsets cannot wrap around.
+bool IsRangeInFile(u64 offset, u64 size, u64 fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+// Alignment of the elements a section is viewed in place as.
+u64 GetSectionAlignment(MeshFileSectionType type)
+{
+    switch (type)
     {
-        LOG_ERROR("loadMeshData: failed to open ", fs::absolute(fileName));
-        return header;
+    case MeshFileSectionType::MESHES:
+        return alignof(Mesh);
+    case MeshFileSectionType::BOUNDING_BOXES:
+        return alignof(BoundingBox);
+    case MeshFileSectionType::INDEX_DATA:
+        return alignof(u32);
+    case MeshFileSectionType::VERTEX_DATA:
+        return alignof(float);
+    case MeshFileSectionType::ENCODED_RANGES:
+        return alignof(MeshFileEncodedRange);
+    default:
+        return 1;
     }
+}
 
-    inFile.read((char*)&header, sizeof(header));
-    if (!inFile.good())
+bool ParseLegacyMeshFile(const std::string& fileName, const u8* data, u64 fileSize,
+                         MeshFileHeader& header, MappedMeshData& meshData)
+{
+    if (fileSize < sizeof(LegacyMeshFileHeader))
     {
         LOG_ERROR("loadMeshData: failed to read file header ", fileName);
-        inFile.close();
-        header.meshCount = 0;
+        return false;
+    }
 
-        return header;
+    LegacyMeshFileHeader legacyHeader;
+    memcpy(&legacyHeader, data, sizeof(legacyHeader));
+
+    header = {
+        .magicNumber = legacyHeader.magicNumber,
+        .version = 0,
+        .meshCount = legacyHeader.meshCount,
+        .sectionCount = 0,
+        .indexDataSize = legacyHeader.indexDataSize,
+        .vertexDataSize = legacyHeader.vertexDataSize,
+        .sectionTableOffset = 0,
+    };
+
+    const u64 meshesOffset = sizeof(LegacyMeshFileHeader);
+    const u64 boundingBoxesOffset = meshesOffset + sizeof(Mesh) * (u64)header.meshCount;
+    const u64 indexDataOffset = boundingBoxesOffset + sizeof(BoundingBox) * (u64)header.meshCount;
+    const u64 vertexDataOffset = indexDataOffset + header.indexDataSize;
+
+    if (vertexDataOffset + header.vertexDataSize > fileSize)
+    {
+        LOG_ERROR("loadMeshData: file ", fileName, " is truncated");
+        return false;
     }
 
-    if (header.magicNumber != MESH_HEADER_MAGIC_NUMBER)
+    // Every section size is a multiple of 4 bytes, so the spans are suitably aligned.
+    meshData.meshes = {reinterpret_cast<const Mesh*>(data + meshesOffset), header.meshCount};
+    meshData.boundingBoxes
+        = {reinterpret_cast<const BoundingBox*>(data + boundingBoxesOffset), header.meshCount};
+    meshData.indexData = {reinterpret_cast<const u32*>(data + indexDataOffset),
+                          header.indexDataSize / sizeof(u32)};
+    meshData.vertexData = {reinterpret_cast<const float*>(data + vertexDataOffset),
+                           header.vertexDataSize / sizeof(float)};
+
+    return true;
+}
+
+bool ParseMeshFile(const std::string& fileName, const u8* data, u64 fileSize,
+                   MeshFileHeader& header, MappedMeshData& meshData)
+{
+    if (fileSize < sizeof(MeshFileHeader))
     {
-        LOG_ERROR("loadMeshData: ", fileName, " is not a mesh type file");
-        inFile.close();
-        header.meshCount = 0;
+        LOG_ERROR("loadMeshData: failed to read file header ", fileName);
+        return false;
+    }
 
-        return header;
+    memcpy(&header, data, sizeof(header));
+
+    if (header.version == 0 || header.version > MESH_FILE_VERSION)
+    {
+        LOG_ERROR("loadMeshData: ", fileName, " has unsupported version ", header.version);
+        return false;
     }
 
-    meshData.meshes.resize(header.meshCount);
-    inFile.read((char*)meshData.meshes.data(), sizeof(Mesh) * header.meshCount);
+    if (!IsRangeInFile(header.sectionTableOffset,
+                       sizeof(MeshFileSection) * (u64)header.sectionCount, fileSize)
+        || header.sectionTableOffset % alignof(MeshFileSection) != 0)
+    {
+        LOG_ERROR("loadMeshData: file ", fileName, " has an invalid section table");
+        return false;
+    }
 
-    meshData.boundingBoxes.resize(header.meshCount);
-    inFile.read((char*)meshData.boundingBoxes.data(), sizeof(BoundingBox) * header.meshCount);
+    std::span<const MeshFileEncodedRange> encodedRanges;
+    std::span<const u8> encodedIndexData;
+    std::span<const u8> encodedVertexData;
+    bool hasEncodedStreams = false;
 
-    meshData.indexData.resize(header.indexDataSize / sizeof(u32));
-    inFile.read((char*)meshData.indexData.data(), header.indexDataSize);
+    const auto* sections
+        = reinterpret_cast<const MeshFileSection*>(data + header.sectionTableOffset);
+    for (u32 i = 0; i < header.sectionCount; i++)
+    {
+        const auto& section = sections[i];
+        if (!IsRangeInFile(section.offset, section.size, fileSize))
+        {
+            LOG_ERROR("loadMeshData: file ", fileName, " is truncated");
+            return false;
+        }
 
-    meshData.vertexData.resize(header.vertexDataSize / sizeof(float));
-    inFile.read((char*)meshData.vertexData.data(), header.vertexDataSize);
+        // The mapping is page aligned, so the offset decides the alignment of the view.
+        if (section.offset % GetSectionAlignment(section.type) != 0)
+        {
+            LOG_ERROR("loadMeshData: file ", fileName, " has a misaligned section");
+            return false;
+        }
 
-    if (!inFile.good())
+        const u8* sectionData = data + section.offset;
+        switch (section.type)
+        {
+        case MeshFileSectionType::MESHES:
+            meshData.meshes = {reinterpret_cast<const Mesh*>(sectionData),
+                               section.size / sizeof(Mesh)};
+            break;
+        case MeshFileSectionType::BOUNDING_BOXES:
+            meshData.boundingBoxes = {reinterpret_cast<const BoundingBox*>(sectionData),
+                                      section.size / sizeof(BoundingBox)};
+            break;
+        case MeshFileSectionType::INDEX_DATA:
+            meshData.indexData
+                = {reinterpret_cast<const u32*>(sectionData), section.size / sizeof(u32)};
+            break;
+        case MeshFileSectionType::VERTEX_DATA:
+            meshData.vertexData
+                = {reinterpret_cast<const float*>(sectionData), section.size / sizeof(float)};
+            break;
+        case MeshFileSectionType::ENCODED_RANGES:
+            encodedRanges = {reinterpret_cast<const MeshFileEncodedRange*>(sectionData),
+                             section.size / sizeof(MeshFileEncodedRange)};
+            hasEncodedStreams = true;
+            break;
+        case MeshFileSectionType::ENCODED_INDEX_DATA:
+            encodedIndexData = {sectionData, section.size};
+            break;
+        case MeshFileSectionType::ENCODED_VERTEX_DATA:
+            encodedVertexData = {sectionData, section.size};
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (meshData.meshes.size() != header.meshCount
+        || meshData.boundingBoxes.size() != header.meshCount)
     {
-        LOG_ERROR("loadMeshData: failed to read mesh data ", fileName);
-        inFile.close();
-        header.meshCount = 0;
+        LOG_ERROR("loadMeshData: file ", fileName, " has mismatching mesh sections");
+        return false;
+    }
+
+    if (hasEncodedStreams)
+    {
+        // Encoded streams cannot be used in place, decode them next to the mapping.
+        auto& decodedData = meshData.decodedData;
+        decodedData.indexData.resize(header.indexDataSize / sizeof(u32));
+        decodedData.vertexData.resize(header.vertexDataSize / sizeof(float));
+
+        if (!DecodeMeshStreams(meshData.meshes, encodedRanges, encodedIndexData,
+                               encodedVertexData, decodedData.indexData, decodedData.vertexData))
+        {
+            LOG_ERROR("loadMeshData: failed to decode mesh streams of ", fileName);
+            return false;
+        }
+
+        meshData.indexData = decodedData.indexData;
+        meshData.vertexData = decodedData.vertexData;
+    }
+
+    return true;
+}
+
+} // namespace
 
+MeshFileHeader LoadMeshData(const std::string& fileName, MappedMeshData& meshData)
+{
+    MeshFileHeader header{};
+
+    meshData = {};
+
+    if (!meshData.file.Open(fileName))
+    {
+        LOG_ERROR("loadMeshData: failed to map ", fs::absolute(fileName));
         return header;
     }
 
-    inFile.close();
+    const u8* data = meshData.file.GetData();
+    const u64 fileSize = meshData.file.GetSize();
+
+    u32 magicNumber = 0;
+    if (fileSize >= sizeof(magicNumber))
+        memcpy(&magicNumber, data, sizeof(magicNumber));
+
+    bool parsed = false;
+    if (magicNumber == MESH_FILE_MAGIC_NUMBER)
+    {
+        parsed = ParseMeshFile(fileName, data, fileSize, header, meshData);
+    }
+    else if (magicNumber == LEGACY_MESH_FILE_MAGIC_NUMBER)
+    {
+        parsed = ParseLegacyMeshFile(fileName, data, fileSize, header, meshData);
+    }
+    else
+    {
+        LOG_ERROR("loadMeshData: ", fileName, " is not a mesh type file");
+    }
+
+    if (!parsed)
+    {
+        meshData = {};
+        header.meshCount = 0;
+    }
 
     return header;
 }
@@ -2,11 +2,17 @@
 
 #include "BoundingBox.h"
 
+#include <MappedFile.h>
+
+#include <span>
 #include <string>
 
 constexpr auto MAX_LODS = 8;
 constexpr auto MAX_STREAMS = 8;
 
+// Interleaved position(3), texcoord(2) and normal(3) floats, as written by the scene converter.
+constexpr auto MESH_VERTEX_FLOAT_COUNT = 3 + 2 + 3;
+
 struct Mesh
 {
     u32 lodCount{0};
@@ -28,6 +34,12 @@ struct Mesh
     {
         return lodOffset[lod + 1] - lodOffset[lod];
     }
+
+    // Index count of all LODs combined.
+    inline u32 GetIndicesCount() const
+    {
+        return lodOffset[lodCount];
+    }
 };
 
 struct MeshData
@@ -38,6 +50,22 @@ struct MeshData
     std::vector<BoundingBox> boundingBoxes;
 };
 
+/*
+ * Read-only view of a .meshes file. All sections point straight into the file mapping, so loading
+ * does not allocate or copy any mesh data. Encoded files are the exception: their index and vertex
+ * data is decoded into decodedData and the spans point there instead.
+ */
+struct MappedMeshData
+{
+    MappedFile file;
+    MeshData decodedData;
+
+    std::span<const Mesh> meshes;
+    std::span<const BoundingBox> boundingBoxes;
+    std::span<const u32> indexData;
+    std::span<const float> vertexData;
+};
+
 struct DrawData
 {
     u32 meshIndex;
@@ -50,7 +78,59 @@ struct DrawData
     u32 transformIndex;
 };
 
+/*
+ * Mesh file layout (version 1):
+ *   MeshFileHeader | MeshFileSection table | section payloads
+ * Every payload starts at a MESH_FILE_SECTION_ALIGNMENT aligned offset, so sections can be mapped
+ * and uploaded without repacking. Readers skip section types they do not know.
+ */
+constexpr u32 MESH_FILE_VERSION = 1;
+constexpr u64 MESH_FILE_SECTION_ALIGNMENT = 4096;
+
+enum class MeshFileSectionType : u32
+{
+    MESHES = 0,
+    BOUNDING_BOXES = 1,
+    // LOD index ranges of all meshes.
+    INDEX_DATA = 2,
+    // Vertex attribute streams of all meshes.
+    VERTEX_DATA = 3,
+    // Reserved, not written yet.
+    MESHLETS = 4,
+    // Compressed replacements of INDEX_DATA and VERTEX_DATA, see MeshCompression.h.
+    ENCODED_RANGES = 5,
+    ENCODED_INDEX_DATA = 6,
+    ENCODED_VERTEX_DATA = 7,
+};
+
+struct MeshFileSection
+{
+    MeshFileSectionType type;
+    u32 elementSize;
+
+    // Absolute offset and size in bytes.
+    u64 offset;
+    u64 size;
+};
+
 struct MeshFileHeader
+{
+    u32 magicNumber;
+    u32 version;
+
+    u32 meshCount;
+    u32 sectionCount;
+
+    // Raw data sizes, not vertex/index count.
+    u64 indexDataSize;
+    u64 vertexDataSize;
+
+    // Offset to the section table.
+    u64 sectionTableOffset;
+};
+
+// Unversioned header of the original format, only kept to read older files.
+struct LegacyMeshFileHeader
 {
     u32 magicNumber;
 
@@ -63,6 +143,8 @@ struct MeshFileHeader
     u32 vertexDataSize;
 };
 
+static_assert(sizeof(MeshFileSection) == 24, "MeshFileSection must be tightly packed!");
+static_assert(sizeof(MeshFileHeader) == 40, "MeshFileHeader must be tightly packed!");
 static_assert(sizeof(BoundingBox) == (sizeof(float) * 6),
               "Size of Bounding Box must be 6 * sizeof floats!");
 static_assert(sizeof(DrawData) == (sizeof(u32) * 6), "Size of DrawData must be 6 * 32 bits!");
@@ -70,10 +152,33 @@ static_assert(sizeof(DrawData) == (sizeof(u32) * 6), "Size of DrawData must be 6
 // Create 1 DrawData per mesh in MeshData.
 std::vector<DrawData> CreateMeshDrawData(const MeshData& meshData);
 
+// Projected bounds size, as a fraction of the screen height, below which LOD 0 is left.
+constexpr float LOD_FULL_DETAIL_SCREEN_SIZE = 0.5f;
+// How far, in LODs, the projected size must leave the current LOD's range to switch.
+constexpr float LOD_HYSTERESIS = 0.25f;
+
+/*
+ * Picks the LOD of every shape from the projected size of its world space bounds: LOD 0 down to
+ * LOD_FULL_DETAIL_SCREEN_SIZE, one LOD coarser every time the size halves after that.
+ * tanHalfFovY is tan(fovY / 2) of the camera.
+ * Returns the number of shapes whose LOD changed.
+ */
+u32 SelectDrawDataLODs(std::span<DrawData> shapes, std::span<const BoundingBox> shapeBounds,
+                       std::span<const Mesh> meshes, const vec3& cameraPosition,
+                       float tanHalfFovY);
+
+// Same as above for the shapes listed in shapeIndices only, e.g. the ones in the view frustum.
+u32 SelectDrawDataLODs(std::span<DrawData> shapes, std::span<const u32> shapeIndices,
+                       std::span<const BoundingBox> shapeBounds, std::span<const Mesh> meshes,
+                       const vec3& cameraPosition, float tanHalfFovY);
+
 void RecalculateBoundingBoxes(MeshData& meshData);
 
-bool SaveMeshData(const std::string& fileName, const MeshData& meshData);
+// If encodeStreams is set, index and vertex data are quantized and compressed.
+bool SaveMeshData(const std::string& fileName, const MeshData& meshData,
+                  bool encodeStreams = false);
 bool SaveDrawData(const std::string& fileName, const std::vector<DrawData>& drawData);
 
 MeshFileHeader LoadMeshData(const std::string& fileName, MeshData& meshData);
+MeshFileHeader LoadMeshData(const std::string& fileName, MappedMeshData& meshData);
 std::vector<DrawData> LoadDrawData(const std::string& fileName);
@@ -0,0 +1,247 @@
+#include "MeshCompression.h"
+
+#include <Logger.h>
+
+#include <meshoptimizer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <execution>
+
+namespace
+{
+
+struct QuantizedVertex
+{
+    float position[3];
+    u16 texCoord[2];
+    i16 normal[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must be tightly packed!");
+
+float DequantizeHalf(u16 h)
+{
+    const u32 sign = u32(h & 0x8000) << 16;
+    const i32 em = h & 0x7fff;
+
+    // Rebias the exponent (127 - 15 = 112) and pad the mantissa, denormals flush to zero.
+    i32 r = (em + (112 << 10)) << 13;
+    r = (em < (1 << 10)) ? 0 : r;
+    // Infinity/NaN.
+    r += (em >= (31 << 10)) ? (112 << 23) : 0;
+
+    const u32 bits = sign | u32(r);
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+inline float SignNotZero(float v)
+{
+    return (v >= 0.0f) ? 1.0f : -1.0f;
+}
+
+void EncodeOctahedral(const float* n, i16* out)
+{
+    const float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+    const float invL1 = (l1 > 0.0f) ? 1.0f / l1 : 0.0f;
+
+    float x = n[0] * invL1;
+    float y = n[1] * invL1;
+
+    // Fold the lower hemisphere over the diagonals.
+    if (n[2] < 0.0f)
+    {
+        const float fx = (1.0f - std::abs(y)) * SignNotZero(x);
+        const float fy = (1.0f - std::abs(x)) * SignNotZero(y);
+        x = fx;
+        y = fy;
+    }
+
+    out[0] = (i16)std::lround(std::clamp(x, -1.0f, 1.0f) * 32767.0f);
+    out[1] = (i16)std::lround(std::clamp(y, -1.0f, 1.0f) * 32767.0f);
+}
+
+void DecodeOctahedral(const i16* in, float* n)
+{
+    float x = std::max(in[0] / 32767.0f, -1.0f);
+    float y = std::max(in[1] / 32767.0f, -1.0f);
+    const float z = 1.0f - std::abs(x) - std::abs(y);
+
+    if (z < 0.0f)
+    {
+        const float fx = (1.0f - std::abs(y)) * SignNotZero(x);
+        const float fy = (1.0f - std::abs(x)) * SignNotZero(y);
+        x = fx;
+        y = fy;
+    }
+
+    const float length = std::sqrt(x * x + y * y + z * z);
+    const float invLength = (length > 0.0f) ? 1.0f / length : 0.0f;
+
+    n[0] = x * invLength;
+    n[1] = y * invLength;
+    n[2] = z * invLength;
+}
+
+bool HasEncodableLayout(const Mesh& mesh)
+{
+    return mesh.streamCount == 1
+           && mesh.streamElementSize[0] == MESH_VERTEX_FLOAT_COUNT * sizeof(float)
+           && (mesh.GetIndicesCount() % 3) == 0;
+}
+
+struct EncodedMesh
+{
+    std::vector<u8> indexData;
+    std::vector<u8> vertexData;
+};
+
+void EncodeMesh(const MeshData& meshData, const Mesh& mesh, EncodedMesh& encoded)
+{
+    const float* src
+        = meshData.vertexData.data() + (size_t)mesh.vertexOffset * MESH_VERTEX_FLOAT_COUNT;
+
+    std::vector<QuantizedVertex> vertices(mesh.vertexCount);
+    for (auto& v : vertices)
+    {
+        v.position[0] = src[0];
+        v.position[1] = src[1];
+        v.position[2] = src[2];
+        v.texCoord[0] = meshopt_quantizeHalf(src[3]);
+        v.texCoord[1] = meshopt_quantizeHalf(src[4]);
+        EncodeOctahedral(src + 5, v.normal);
+
+        src += MESH_VERTEX_FLOAT_COUNT;
+    }
+
+    encoded.vertexData.resize(
+        meshopt_encodeVertexBufferBound(vertices.size(), sizeof(QuantizedVertex)));
+    encoded.vertexData.resize(
+        meshopt_encodeVertexBuffer(encoded.vertexData.data(), encoded.vertexData.size(),
+                                   vertices.data(), vertices.size(), sizeof(QuantizedVertex)));
+
+    const u32* indices = meshData.indexData.data() + mesh.indexOffset;
+    const size_t indexCount = mesh.GetIndicesCount();
+
+    encoded.indexData.resize(meshopt_encodeIndexBufferBound(indexCount, mesh.vertexCount));
+    encoded.indexData.resize(meshopt_encodeIndexBuffer(
+        encoded.indexData.data(), encoded.indexData.size(), indices, indexCount));
+}
+
+} // namespace
+
+bool EncodeMeshStreams(const MeshData& meshData, EncodedMeshStreams& streams)
+{
+    if (!std::all_of(meshData.meshes.begin(), meshData.meshes.end(), HasEncodableLayout))
+    {
+        LOG_WARN("EncodeMeshStreams: unsupported vertex layout or index topology");
+        return false;
+    }
+
+    std::vector<EncodedMesh> encodedMeshes(meshData.meshes.size());
+
+    std::for_each(std::execution::par, meshData.meshes.begin(), meshData.meshes.end(),
+                  [&](const Mesh& mesh) {
+                      const auto i = &mesh - meshData.meshes.data();
+                      EncodeMesh(meshData, mesh, encodedMeshes[i]);
+                  });
+
+    streams.ranges.clear();
+    streams.ranges.reserve(encodedMeshes.size());
+    streams.indexData.clear();
+    streams.vertexData.clear();
+
+    for (const auto& encoded : encodedMeshes)
+    {
+        streams.ranges.push_back({
+            .indexOffset = streams.indexData.size(),
+            .indexSize = encoded.indexData.size(),
+            .vertexOffset = streams.vertexData.size(),
+            .vertexSize = encoded.vertexData.size(),
+        });
+
+        streams.indexData.insert(streams.indexData.end(), encoded.indexData.begin(),
+                                 encoded.indexData.end());
+        streams.vertexData.insert(streams.vertexData.end(), encoded.vertexData.begin(),
+                                  encoded.vertexData.end());
+    }
+
+    return true;
+}
+
+bool DecodeMeshStreams(std::span<const Mesh> meshes, std::span<const MeshFileEncodedRange> ranges,
+                       std::span<const u8> encodedIndexData, std::span<const u8> encodedVertexData,
+                       std::span<u32> indexData, std::span<float> vertexData)
+{
+    if (ranges.size() != meshes.size())
+    {
+        LOG_ERROR("DecodeMeshStreams: mesh count does not match encoded range count");
+        return false;
+    }
+
+    std::atomic<bool> success{true};
+
+    std::for_each(std::execution::par, meshes.begin(), meshes.end(), [&](const Mesh& mesh) {
+        const auto& range = ranges[&mesh - meshes.data()];
+
+        const u64 indexCount = mesh.GetIndicesCount();
+        const u64 vertexFloatCount = (u64)mesh.vertexCount * MESH_VERTEX_FLOAT_COUNT;
+
+        if (range.indexOffset + range.indexSize > encodedIndexData.size()
+            || range.vertexOffset + range.vertexSize > encodedVertexData.size()
+            || mesh.indexOffset + indexCount > indexData.size()
+            || (u64)mesh.vertexOffset * MESH_VERTEX_FLOAT_COUNT + vertexFloatCount
+                   > vertexData.size())
+        {
+            success = false;
+            return;
+        }
+
+        if (indexCount > 0
+            && meshopt_decodeIndexBuffer(indexData.data() + mesh.indexOffset, indexCount,
+                                         sizeof(u32), encodedIndexData.data() + range.indexOffset,
+                                         range.indexSize)
+                   != 0)
+        {
+            success = false;
+            return;
+        }
+
+        std::vector<QuantizedVertex> vertices(mesh.vertexCount);
+        if (mesh.vertexCount > 0
+            && meshopt_decodeVertexBuffer(vertices.data(), vertices.size(),
+                                          sizeof(QuantizedVertex),
+                                          encodedVertexData.data() + range.vertexOffset,
+                                          range.vertexSize)
+                   != 0)
+        {
+            success = false;
+            return;
+        }
+
+        float* dst = vertexData.data() + (size_t)mesh.vertexOffset * MESH_VERTEX_FLOAT_COUNT;
+        for (const auto& v : vertices)
+        {
+            dst[0] = v.position[0];
+            dst[1] = v.position[1];
+            dst[2] = v.position[2];
+            dst[3] = DequantizeHalf(v.texCoord[0]);
+            dst[4] = DequantizeHalf(v.texCoord[1]);
+            DecodeOctahedral(v.normal, dst + 5);
+
+            dst += MESH_VERTEX_FLOAT_COUNT;
+        }
+    });
+
+    if (!success)
+    {
+        LOG_ERROR("DecodeMeshStreams: corrupt encoded mesh data");
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Mesh.h"
+
+#include <span>
+#include <vector>
+
+/*
+ * Encoded mesh streams, built on the meshoptimizer vertex and index codecs.
+ *
+ * Vertices are quantized before encoding: positions stay 32-bit floats, texture coordinates are
+ * stored as half floats and normals as 16-bit octahedral vectors (20 bytes instead of 32).
+ * Every mesh is encoded separately so the streams can be decoded in parallel.
+ */
+struct MeshFileEncodedRange
+{
+    // Offsets are relative to the start of the encoded index/vertex sections.
+    u64 indexOffset;
+    u64 indexSize;
+    u64 vertexOffset;
+    u64 vertexSize;
+};
+
+static_assert(sizeof(MeshFileEncodedRange) == 32, "MeshFileEncodedRange must be tightly packed!");
+
+struct EncodedMeshStreams
+{
+    std::vector<MeshFileEncodedRange> ranges;
+    std::vector<u8> indexData;
+    std::vector<u8> vertexData;
+};
+
+// Returns false if the vertex layout is not MESH_VERTEX_FLOAT_COUNT interleaved floats.
+bool EncodeMeshStreams(const MeshData& meshData, EncodedMeshStreams& streams);
+
+// Decodes into indexData and vertexData, which must already be sized to hold all meshes.
+bool DecodeMeshStreams(std::span<const Mesh> meshes, std::span<const MeshFileEncodedRange> ranges,
+                       std::span<const u8> encodedIndexData, std::span<const u8> encodedVertexData,
+                       std::span<u32> indexData, std::span<float> vertexData);
@@ -1,107 +1,246 @@
 #include "Scene.h"
 #include "Utils.h"
 
+#include <CoreMaths.h>
 #include <CoreUtils.h>
 #include <Logger.h>
+#include <MappedFile.h>
 
 #include <algorithm>
+#include <cstring>
+#include <execution>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <numeric>
+#include <span>
 
 namespace fs = std::filesystem;
 
+namespace
+{
+
+// Appends node to the child list of parent.
+void LinkChild(Scene& scene, u32 parent, u32 node)
+{
+    scene.hierarchy[node].parent = parent;
+    scene.hierarchy[node].nextSibling = u32(-1);
+
+    u32 firstChild = scene.hierarchy[parent].firstChild;
+
+    if (firstChild == u32(-1))
+    {
+        scene.hierarchy[parent].firstChild = node;
+        scene.hierarchy[node].lastSibling = node;
+    }
+    else
+    {
+        u32 lastSibling = scene.hierarchy[firstChild].lastSibling;
+        if (lastSibling == u32(-1))
+        {
+            // No cached last sibling, iterate nextSibling to get last sibling.
+            for (lastSibling = firstChild; scene.hierarchy[lastSibling].nextSibling != u32(-1);
+                 lastSibling = scene.hierarchy[lastSibling].nextSibling)
+                ;
+        }
+
+        scene.hierarchy[lastSibling].nextSibling = node;
+        scene.hierarchy[firstChild].lastSibling = node;
+    }
+}
+
+} // namespace
+
 u32 AddNode(Scene& scene, u32 parent, u32 level)
 {
     u32 node = (u32)scene.hierarchy.size();
     scene.localTransforms.push_back(glm::mat4(1.0f));
     scene.globalTransforms.push_back(glm::mat4(1.0f));
+    scene.dirtyGeneration.resize(node + 1, 0);
 
     scene.hierarchy.push_back({
         .parent = parent,
         .lastSibling = u32(-1),
+        .level = level,
     });
 
     if (parent != u32(-1))
     {
-        u32 firstChild = scene.hierarchy[parent].firstChild;
+        LinkChild(scene, parent, node);
 
-        if (firstChild == u32(-1))
+        // MarkAsChanged skips queued nodes assuming their whole subtree is queued too.
+        if (scene.dirtyGeneration[parent] == scene.currentGeneration)
         {
-            scene.hierarchy[parent].firstChild = node;
-            scene.hierarchy[node].lastSibling = node;
+            scene.dirtyGeneration[node] = scene.currentGeneration;
+            scene.changedAtThisFrame[level].push_back((int)node);
         }
+    }
+
+    return node;
+}
+
+// Levels with fewer changed nodes than this are cheaper to update serially.
+constexpr size_t PARALLEL_TRANSFORM_THRESHOLD = 1024;
+
+u32 RecalculateGlobalTransforms(Scene& scene)
+{
+    // Root nodes have no parent, their global transform is the local one.
+    for (const auto node : scene.changedAtThisFrame[0])
+        scene.globalTransforms[node] = scene.localTransforms[node];
+
+    u32 updatedCount = (u32)scene.changedAtThisFrame[0].size();
+    scene.changedAtThisFrame[0].clear();
+
+    // Nodes only read the global transforms of the level above, so a level updates in any order.
+    for (u32 i = 1; i < MAX_SCENE_LEVEL; i++)
+    {
+        auto& changed = scene.changedAtThisFrame[i];
+        if (changed.empty())
+            continue;
+
+        // Sorted nodes walk the level ordered transforms linearly. MarkAsChanged never queues a
+        // node twice, but nodes pushed directly could be duplicated and would race.
+        std::sort(changed.begin(), changed.end());
+        changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+
+        auto update = [&scene](int node) {
+            const u32 parent = scene.hierarchy[node].parent;
+            MultiplyMat4(scene.globalTransforms[parent], scene.localTransforms[node],
+                         scene.globalTransforms[node]);
+        };
+
+        if (changed.size() >= PARALLEL_TRANSFORM_THRESHOLD)
+            std::for_each(std::execution::par, changed.begin(), changed.end(), update);
         else
-        {
-            u32 lastSibling = scene.hierarchy[firstChild].lastSibling;
-            if (lastSibling == u32(-1))
-            {
-                // No cached last sibling, iterate nextSibling to get last sibling.
-                for (lastSibling = firstChild; scene.hierarchy[lastSibling].nextSibling != u32(-1);
-                     lastSibling = scene.hierarchy[lastSibling].nextSibling)
-                    ;
-            }
+            std::for_each(changed.begin(), changed.end(), update);
 
-            scene.hierarchy[lastSibling].nextSibling = node;
-            scene.hierarchy[firstChild].lastSibling = node;
-        }
+        updatedCount += (u32)changed.size();
+        changed.clear();
     }
 
-    scene.hierarchy[node].level = level;
-    scene.hierarchy[node].nextSibling = u32(-1);
-    scene.hierarchy[node].firstChild = u32(-1);
+    // Every node can be queued again.
+    if (++scene.currentGeneration == 0)
+    {
+        std::fill(scene.dirtyGeneration.begin(), scene.dirtyGeneration.end(), 0);
+        scene.currentGeneration = 1;
+    }
 
-    return node;
+    return updatedCount;
 }
 
-void RecalculateGlobalTransforms(Scene& scene)
+u32 MarkAsChanged(Scene& scene, u32 node)
 {
-    // Update root node global transform.
-    if (!scene.changedAtThisFrame[0].empty())
+    if (scene.dirtyGeneration.size() != scene.hierarchy.size())
+        scene.dirtyGeneration.resize(scene.hierarchy.size(), 0);
+
+    u32 markedCount = 0;
+
+    // Explicit stack, deep hierarchies would overflow the call stack.
+    std::vector<u32> stack = {node};
+    while (!stack.empty())
     {
-        int node = scene.changedAtThisFrame[0][0];
-        scene.globalTransforms[node] = scene.localTransforms[node];
-        scene.changedAtThisFrame[0].clear();
+        const u32 n = stack.back();
+        stack.pop_back();
+
+        // A queued node has queued its whole subtree already.
+        if (scene.dirtyGeneration[n] == scene.currentGeneration)
+            continue;
+
+        scene.dirtyGeneration[n] = scene.currentGeneration;
+        scene.changedAtThisFrame[scene.hierarchy[n].level].push_back((int)n);
+        markedCount++;
+
+        for (auto s = scene.hierarchy[n].firstChild; s != u32(-1);
+             s = scene.hierarchy[s].nextSibling)
+            stack.push_back(s);
     }
 
-    for (unsigned int i = 1; i < MAX_SCENE_LEVEL && (!scene.changedAtThisFrame[i].empty()); i++)
+    return markedCount;
+}
+
+/*
+ * Node name index.
+ */
+namespace
+{
+
+constexpr size_t MIN_NAME_INDEX_SLOTS = 16;
+
+u64 HashName(std::string_view name)
+{
+    return HashBytes(name.data(), name.size());
+}
+
+void InsertNameSlot(SceneNameIndex& index, u64 hash, u32 node)
+{
+    const size_t mask = index.slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
     {
-        for (const auto& node : scene.changedAtThisFrame[i])
+        if (index.slots[i].node == u32(-1))
         {
-            auto parent = scene.hierarchy[node].parent;
-            scene.globalTransforms[node]
-                = scene.globalTransforms[parent] * scene.localTransforms[node];
+            index.slots[i] = {.hash = u32(hash >> 32), .node = node};
+            index.usedSlotCount++;
+            return;
         }
-        scene.changedAtThisFrame[i].clear();
     }
 }
 
-void MarkAsChanged(Scene& scene, u32 node)
+} // namespace
+
+void RebuildNameIndex(Scene& scene)
 {
-    u32 level = scene.hierarchy[node].level;
-    scene.changedAtThisFrame[level].push_back(node);
+    auto& index = scene.nameIndex;
+
+    const u32 namedCount = (u32)scene.nameIds.size();
 
-    // XXX: Do this iteratively.
-    for (auto s = scene.hierarchy[node].firstChild; s != u32(-1);
-         s = scene.hierarchy[s].nextSibling)
-        MarkAsChanged(scene, s);
+    // Keep the load factor at or below one half so probe sequences stay short.
+    size_t slotCount = MIN_NAME_INDEX_SLOTS;
+    while (slotCount < size_t(namedCount) * 2)
+        slotCount *= 2;
+
+    index.slots.assign(slotCount, {});
+    index.usedSlotCount = 0;
+
+    for (size_t i = 0; i < scene.nameIds.size(); i++)
+    {
+        const u32 id = scene.nameIds.values[i];
+        if (id < scene.names.size())
+            InsertNameSlot(index, HashName(scene.names[id]), scene.nameIds.nodes[i]);
+    }
 }
 
-u32 FindNodeByName(const Scene& scene, const std::string& name)
+void SetNodeName(Scene& scene, u32 node, std::string_view name)
 {
-    // Linear search on each scene id.
-    for (auto i = 0; i < scene.localTransforms.size(); i++)
+    u32 id = scene.names.Add(name);
+    SetComponent(scene.nameIds, node, id);
+
+    auto& index = scene.nameIndex;
+    if (size_t(index.usedSlotCount + 1) * 2 > index.slots.size())
+        RebuildNameIndex(scene);
+    else
+        InsertNameSlot(index, HashName(name), node);
+}
+
+u32 FindNodeByName(const Scene& scene, std::string_view name)
+{
+    const auto& index = scene.nameIndex;
+    if (index.slots.empty())
+        return u32(-1);
+
+    const u64 hash = HashName(name);
+    const size_t mask = index.slots.size() - 1;
+
+    // Duplicate names and stale slots share the probe sequence, keep the lowest matching node.
+    u32 result = u32(-1);
+    for (size_t i = hash & mask; index.slots[i].node != u32(-1); i = (i + 1) & mask)
     {
-        if (scene.namesMap.contains(i))
-        {
-            u32 strID = scene.namesMap.at(i);
-            if (strID != u32(-1))
-                if (scene.names[strID] == name)
-                    return (int)i;
-        }
+        const auto& slot = index.slots[i];
+        if (slot.hash == u32(hash >> 32) && slot.node < result
+            && GetNodeName(scene, slot.node) == name)
+            result = slot.node;
     }
 
-    return u32(-1);
+    return result;
 }
 
 u32 GetNodeLevel(const Scene& scene, u32 node)
@@ -118,306 +257,950 @@ u32 GetNodeLevel(const Scene& scene, u32 node)
     return level;
 }
 
+void MarkAllAsChanged(Scene& scene)
+{
+    const u32 nodeCount = (u32)scene.hierarchy.size();
+
+    for (auto& changed : scene.changedAtThisFrame)
+        changed.clear();
+
+    if (IsSceneSortedByLevel(scene))
+    {
+        for (u32 first = 0; first < nodeCount;)
+        {
+            const u32 level = scene.hierarchy[first].level;
+
+            u32 last = first;
+            while (last < nodeCount && scene.hierarchy[last].level == level)
+                last++;
+
+            auto& changed = scene.changedAtThisFrame[level];
+            changed.resize(last - first);
+            std::iota(changed.begin(), changed.end(), (int)first);
+
+            first = last;
+        }
+    }
+    else
+    {
+        for (u32 node = 0; node < nodeCount; node++)
+            scene.changedAtThisFrame[scene.hierarchy[node].level].push_back((int)node);
+    }
+
+    scene.dirtyGeneration.assign(nodeCount, scene.currentGeneration);
+}
+
 /*
  * Scene saving and loading.
  */
-bool SaveScene(const std::string& fileName, Scene& scene)
+static constexpr u32 SCENE_FILE_MAGIC_NUMBER = 0x454E4353; // "SCNE"
+
+namespace
 {
-    std::ofstream file(fileName, std::ios::out | std::ios::binary);
-    if (!file)
+
+struct SceneFileSectionData
+{
+    SceneFileSectionType type;
+    u32 elementSize;
+    const void* data;
+    u64 size;
+};
+
+inline u64 AlignSceneFileOffset(u64 offset)
+{
+    return (offset + SCENE_FILE_SECTION_ALIGNMENT - 1) & ~(SCENE_FILE_SECTION_ALIGNMENT - 1);
+}
+
+template <typename T> bool CopySection(std::span<const u8> section, std::vector<T>& out)
+{
+    if (section.size() % sizeof(T) != 0)
+        return false;
+
+    out.resize(section.size() / sizeof(T));
+    memcpy(out.data(), section.data(), section.size());
+    return true;
+}
+
+bool ParseSceneFile(const std::string& fileName, const std::shared_ptr<const MappedFile>& file,
+                    Scene& scene)
+{
+    const u8* data = file->GetData();
+    const u64 fileSize = file->GetSize();
+
+    SceneFileHeader header;
+    if (fileSize < sizeof(header))
     {
-        LOG_ERROR("saveScene: failed to open file ", fs::absolute(fileName));
+        LOG_ERROR("LoadScene: failed to read file header ", fileName);
         return false;
     }
 
-    const u32 nodeCount = (u32)scene.hierarchy.size();
-    file.write((const char*)&nodeCount, sizeof(nodeCount));
-
-    file.write((const char*)scene.localTransforms.data(), sizeof(mat4) * nodeCount);
-    file.write((const char*)scene.globalTransforms.data(), sizeof(mat4) * nodeCount);
-    file.write((const char*)scene.hierarchy.data(), sizeof(SceneHierarchy) * nodeCount);
+    memcpy(&header, data, sizeof(header));
 
-    SaveMap(file, scene.materialsMap);
-    SaveMap(file, scene.meshesMap);
+    if (header.version == 0 || header.version > SCENE_FILE_VERSION)
+    {
+        LOG_ERROR("LoadScene: ", fileName, " has unsupported version ", header.version);
+        return false;
+    }
 
-    if (!scene.names.empty() && !scene.namesMap.empty())
+    if (header.sectionTableOffset + sizeof(SceneFileSection) * (u64)header.sectionCount
+        > fileSize)
     {
-        SaveMap(file, scene.namesMap);
-        SaveStringArray(file, scene.names);
-        SaveStringArray(file, scene.materialNames);
+        LOG_ERROR("LoadScene: file ", fileName, " has an invalid section table");
+        return false;
     }
 
-    file.close();
+    bool valid = true;
 
-    return true;
-}
+    const auto* sections
+        = reinterpret_cast<const SceneFileSection*>(data + header.sectionTableOffset);
+    for (u32 i = 0; i < header.sectionCount && valid; i++)
+    {
+        const auto& section = sections[i];
+        if (section.offset + section.size > fileSize)
+        {
+            LOG_ERROR("LoadScene: file ", fileName, " is truncated");
+            return false;
+        }
 
-bool LoadScene(const std::string& fileName, Scene& scene)
-{
-    std::ifstream file(fileName, std::ios::out | std::ios::binary);
+        const std::span<const u8> sectionData(data + section.offset, section.size);
+        switch (section.type)
+        {
+        case SceneFileSectionType::LOCAL_TRANSFORMS:
+            valid = CopySection(sectionData, scene.localTransforms);
+            break;
+        case SceneFileSectionType::HIERARCHY:
+            valid = CopySection(sectionData, scene.hierarchy);
+            break;
+        case SceneFileSectionType::MESH_ID_NODES:
+            valid = CopySection(sectionData, scene.meshIds.nodes);
+            break;
+        case SceneFileSectionType::MESH_ID_VALUES:
+            valid = CopySection(sectionData, scene.meshIds.values);
+            break;
+        case SceneFileSectionType::MATERIAL_ID_NODES:
+            valid = CopySection(sectionData, scene.materialIds.nodes);
+            break;
+        case SceneFileSectionType::MATERIAL_ID_VALUES:
+            valid = CopySection(sectionData, scene.materialIds.values);
+            break;
+        case SceneFileSectionType::NAME_ID_NODES:
+            valid = CopySection(sectionData, scene.nameIds.nodes);
+            break;
+        case SceneFileSectionType::NAME_ID_VALUES:
+            valid = CopySection(sectionData, scene.nameIds.values);
+            break;
+        case SceneFileSectionType::NAMES:
+            valid = (header.version == 1) ? UnpackStringArray(sectionData, scene.names)
+                                          : scene.names.View(sectionData, file);
+            break;
+        case SceneFileSectionType::MATERIAL_NAMES:
+            valid = (header.version == 1) ? UnpackStringArray(sectionData, scene.materialNames)
+                                          : scene.materialNames.View(sectionData, file);
+            break;
+        default:
+            break;
+        }
+    }
 
-    if (!file)
+    if (!valid || scene.hierarchy.size() != header.nodeCount
+        || scene.localTransforms.size() != header.nodeCount)
     {
-        LOG_ERROR("LoadScene: failed to open ", fs::absolute(fileName));
+        LOG_ERROR("LoadScene: file ", fileName, " has invalid node sections");
         return false;
     }
 
-    u32 size = 0;
-    file.read((char*)&size, sizeof(size));
+    return true;
+}
 
-    scene.hierarchy.resize(size);
-    scene.globalTransforms.resize(size);
-    scene.localTransforms.resize(size);
+bool ValidateComponents(const SceneComponents& components, u32 nodeCount)
+{
+    if (components.nodes.size() != components.values.size())
+        return false;
 
-    /*
-     * XXX:
-     *   - Check that scene nodes are valid / not u32(-1)
-     *   - Recalculate ChangedAtThisLevel / find max depth of a node, or cache max level/depth
-     * somewhere.
-     */
+    for (size_t i = 0; i < components.nodes.size(); i++)
+    {
+        if (components.nodes[i] >= nodeCount
+            || (i > 0 && components.nodes[i] <= components.nodes[i - 1]))
+            return false;
+    }
 
-    file.read((char*)scene.localTransforms.data(), sizeof(mat4) * size);
-    file.read((char*)scene.globalTransforms.data(), sizeof(mat4) * size);
-    file.read((char*)scene.hierarchy.data(), sizeof(SceneHierarchy) * size);
+    return true;
+}
 
-    LoadMap(file, scene.materialsMap);
-    LoadMap(file, scene.meshesMap);
+// Checks that every node link and component is in range, components sorted by node.
+bool ValidateNodeLinks(const std::string& fileName, const Scene& scene)
+{
+    const u32 nodeCount = (u32)scene.hierarchy.size();
+    auto isValidLink = [nodeCount](u32 node) { return node == u32(-1) || node < nodeCount; };
 
-    if (!file.eof())
+    for (u32 node = 0; node < nodeCount; node++)
     {
-        LoadMap(file, scene.namesMap);
-        LoadStringArray(file, scene.names);
-        LoadStringArray(file, scene.materialNames);
+        const auto& h = scene.hierarchy[node];
+        if (!isValidLink(h.parent) || !isValidLink(h.firstChild) || !isValidLink(h.nextSibling)
+            || !isValidLink(h.lastSibling))
+        {
+            LOG_ERROR("LoadScene: file ", fileName, " has an invalid node ", node);
+            return false;
+        }
     }
 
-    if (!file.good())
+    if (!ValidateComponents(scene.meshIds, nodeCount)
+        || !ValidateComponents(scene.materialIds, nodeCount)
+        || !ValidateComponents(scene.nameIds, nodeCount))
     {
-        LOG_ERROR("loadScene: failed to read scene data - ", fileName);
+        LOG_ERROR("LoadScene: file ", fileName, " has invalid components");
         return false;
     }
 
-    file.close();
+    for (const u32 id : scene.nameIds.values)
+    {
+        if (id >= scene.names.size())
+        {
+            LOG_ERROR("LoadScene: file ", fileName, " has an invalid name id ", id);
+            return false;
+        }
+    }
 
     return true;
 }
 
 /*
- * More advanced scene operations.
+ * Checks that every child chain links back to its parent and that no node is reached twice, which
+ * also rejects cyclic sibling chains. Expects links to be in range.
  */
-namespace
+bool ValidateChildLinks(const std::string& fileName, const Scene& scene)
 {
+    const u32 nodeCount = (u32)scene.hierarchy.size();
 
-/*
- * Shift hierarchies.
- */
-void ShiftNodes(Scene& scene, u32 startOffset, u32 nodeCount, u32 shiftAmount)
-{
-    auto ShiftNode = [shiftAmount](SceneHierarchy& node) {
-        if (node.parent != u32(-1))
-            node.parent += shiftAmount;
-        if (node.firstChild != u32(-1))
-            node.firstChild += shiftAmount;
-        if (node.nextSibling != u32(-1))
-            node.nextSibling += shiftAmount;
-        if (node.lastSibling != u32(-1))
-            node.lastSibling += shiftAmount;
-    };
+    std::vector<u8> visited(nodeCount, 0);
+    u32 childCount = 0;
+    for (u32 node = 0; node < nodeCount; node++)
+    {
+        for (u32 c = scene.hierarchy[node].firstChild; c != u32(-1);
+             c = scene.hierarchy[c].nextSibling)
+        {
+            if (visited[c] || scene.hierarchy[c].parent != node)
+            {
+                LOG_ERROR("LoadScene: file ", fileName, " has an invalid child link at node ", c);
+                return false;
+            }
+
+            visited[c] = 1;
+            childCount++;
+        }
+
+        if (scene.hierarchy[node].parent != u32(-1))
+            childCount--;
+    }
 
-    for (int i = 0; i < nodeCount; i++)
-        ShiftNode(scene.hierarchy[i + startOffset]);
+    // Every node with a parent has to be in its parent's chain.
+    if (childCount != 0)
+    {
+        LOG_ERROR("LoadScene: file ", fileName, " has nodes missing from their parent");
+        return false;
+    }
+
+    return true;
 }
 
-using ItemMap = std::unordered_map<u32, u32>;
-void MergeMaps(ItemMap& m, const ItemMap& otherMap, int indexOffset, int itemOffset)
+// Checks links and components, that parents precede their children and that nodes are in level
+// order.
+bool ValidateScene(const std::string& fileName, const Scene& scene)
 {
-    for (const auto& i : otherMap)
-        m[i.first + indexOffset] = i.second + itemOffset;
+    if (!ValidateNodeLinks(fileName, scene) || !ValidateChildLinks(fileName, scene))
+        return false;
+
+    for (u32 node = 0; node < (u32)scene.hierarchy.size(); node++)
+    {
+        const auto& h = scene.hierarchy[node];
+
+        const bool validLevel
+            = (h.level < MAX_SCENE_LEVEL)
+              && ((h.parent == u32(-1) && h.level == 0)
+                  || (h.parent < node && scene.hierarchy[h.parent].level + 1 == h.level))
+              && (node == 0 || scene.hierarchy[node - 1].level <= h.level);
+
+        if (!validLevel)
+        {
+            LOG_ERROR("LoadScene: file ", fileName, " has an invalid level at node ", node);
+            return false;
+        }
+    }
+
+    return true;
 }
 
-void AddUniqueIndex(std::vector<u32>& v, u32 index)
+// Bounds checked reads for the unversioned format.
+struct LegacySceneReader
 {
-    if (!std::binary_search(v.begin(), v.end(), index))
-        v.push_back(index);
-}
+    const u8* data;
+    u64 size;
+    u64 offset{0};
+
+    bool Read(void* out, u64 byteCount)
+    {
+        if (offset + byteCount > size)
+            return false;
+
+        memcpy(out, data + offset, byteCount);
+        offset += byteCount;
+        return true;
+    }
+
+    bool ReadComponents(SceneComponents& components, u32 nodeCount)
+    {
+        u32 count = 0;
+        if (!Read(&count, sizeof(count)) || count > (size - offset) / sizeof(u32))
+            return false;
+
+        std::vector<u32> pairs(count);
+        if (!Read(pairs.data(), sizeof(u32) * count))
+            return false;
+
+        components.nodes.resize(count / 2);
+        components.values.resize(count / 2);
+        for (u32 i = 0; i < count / 2; i++)
+        {
+            if (pairs[i * 2] >= nodeCount)
+                return false;
+
+            components.nodes[i] = pairs[i * 2];
+            components.values[i] = pairs[(i * 2) + 1];
+        }
 
-// Recurse down the tree and add nodes to delete.
-void CollectNodesToDelete(const Scene& scene, u32 node, std::vector<u32>& nodes)
+        return true;
+    }
+
+    bool ReadStringArray(StringTable& strings)
+    {
+        const std::span<const u8> remaining(data + offset, size - offset);
+        if (!UnpackStringArray(remaining, strings))
+            return false;
+
+        // Every string was stored with a u32 length instead of an offset.
+        offset += sizeof(u32) * (strings.size() + 1) + strings.GetCharCount();
+        return true;
+    }
+};
+
+bool ParseLegacySceneFile(const std::string& fileName, const u8* data, u64 fileSize,
+                          Scene& scene)
 {
-    for (int n = scene.hierarchy[node].firstChild; n != u32(-1); n = scene.hierarchy[n].nextSibling)
+    LegacySceneReader reader{.data = data, .size = fileSize};
+
+    u32 nodeCount = 0;
+    reader.Read(&nodeCount, sizeof(nodeCount));
+
+    if (nodeCount > fileSize / (sizeof(mat4) * 2 + sizeof(SceneHierarchy)))
+    {
+        LOG_ERROR("LoadScene: file ", fileName, " is truncated");
+        return false;
+    }
+
+    scene.localTransforms.resize(nodeCount);
+    scene.hierarchy.resize(nodeCount);
+
+    // Global transforms are recalculated, skip them.
+    bool valid = reader.Read(scene.localTransforms.data(), sizeof(mat4) * nodeCount);
+    reader.offset += sizeof(mat4) * nodeCount;
+    valid = valid && reader.Read(scene.hierarchy.data(), sizeof(SceneHierarchy) * nodeCount);
+
+    valid = valid && reader.ReadComponents(scene.materialIds, nodeCount);
+    valid = valid && reader.ReadComponents(scene.meshIds, nodeCount);
+
+    if (valid && reader.offset < reader.size)
+    {
+        valid = reader.ReadComponents(scene.nameIds, nodeCount)
+                && reader.ReadStringArray(scene.names)
+                && reader.ReadStringArray(scene.materialNames);
+    }
+
+    if (!valid)
+    {
+        LOG_ERROR("LoadScene: failed to read scene data - ", fileName);
+        return false;
+    }
+
+    // Older files were written in hash map order and may carry stale levels.
+    SortComponents(scene.meshIds);
+    SortComponents(scene.materialIds);
+    SortComponents(scene.nameIds);
+
+    if (!ValidateNodeLinks(fileName, scene))
+        return false;
+
+    // A node reached twice means a cycle through firstChild or nextSibling links.
+    std::vector<u8> visited(nodeCount, 0);
+    std::vector<u32> stack;
+    for (u32 root = 0; root < nodeCount; root++)
+    {
+        if (scene.hierarchy[root].parent != u32(-1))
+            continue;
+
+        scene.hierarchy[root].level = 0;
+        visited[root] = 1;
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            const u32 node = stack.back();
+            stack.pop_back();
+
+            for (u32 c = scene.hierarchy[node].firstChild; c < nodeCount;
+                 c = scene.hierarchy[c].nextSibling)
+            {
+                if (visited[c])
+                {
+                    LOG_ERROR("LoadScene: file ", fileName, " has a cyclic hierarchy");
+                    return false;
+                }
+
+                visited[c] = 1;
+                scene.hierarchy[c].level = scene.hierarchy[node].level + 1;
+                stack.push_back(c);
+            }
+        }
+    }
+
+    if (!IsSceneSortedByLevel(scene))
     {
-        AddUniqueIndex(nodes, n);
-        CollectNodesToDelete(scene, n, nodes);
+        scene.globalTransforms.assign(nodeCount, mat4(1.0f));
+        ReorderSceneByLevel(scene);
     }
+
+    return true;
 }
 
-u32 FindLastNonDeletedItem(const Scene& scene, const std::vector<u32>& newIndices, u32 node)
+} // namespace
+
+bool SaveScene(const std::string& fileName, Scene& scene)
 {
-    if (node == u32(-1))
-        return u32(-1);
+    if (!IsSceneSortedByLevel(scene))
+        ReorderSceneByLevel(scene);
+
+    std::ofstream file(fileName, std::ios::out | std::ios::binary);
+    if (!file)
+    {
+        LOG_ERROR("saveScene: failed to open file ", fs::absolute(fileName));
+        return false;
+    }
+
+    std::vector<u8> names;
+    std::vector<u8> materialNames;
+    scene.names.Serialize(names);
+    scene.materialNames.Serialize(materialNames);
+
+    auto componentSection = [](SceneFileSectionType type, const std::vector<u32>& v) {
+        return SceneFileSectionData{type, sizeof(u32), v.data(), v.size() * sizeof(u32)};
+    };
+
+    const u32 nodeCount = (u32)scene.hierarchy.size();
+    const std::vector<SceneFileSectionData> sectionData = {
+        {SceneFileSectionType::LOCAL_TRANSFORMS, sizeof(mat4), scene.localTransforms.data(),
+         nodeCount * sizeof(mat4)},
+        {SceneFileSectionType::HIERARCHY, sizeof(SceneHierarchy), scene.hierarchy.data(),
+         nodeCount * sizeof(SceneHierarchy)},
+        componentSection(SceneFileSectionType::MESH_ID_NODES, scene.meshIds.nodes),
+        componentSection(SceneFileSectionType::MESH_ID_VALUES, scene.meshIds.values),
+        componentSection(SceneFileSectionType::MATERIAL_ID_NODES, scene.materialIds.nodes),
+        componentSection(SceneFileSectionType::MATERIAL_ID_VALUES, scene.materialIds.values),
+        componentSection(SceneFileSectionType::NAME_ID_NODES, scene.nameIds.nodes),
+        componentSection(SceneFileSectionType::NAME_ID_VALUES, scene.nameIds.values),
+        {SceneFileSectionType::NAMES, sizeof(u8), names.data(), names.size()},
+        {SceneFileSectionType::MATERIAL_NAMES, sizeof(u8), materialNames.data(),
+         materialNames.size()},
+    };
+
+    const u32 sectionCount = (u32)sectionData.size();
+
+    const SceneFileHeader header = {
+        .magicNumber = SCENE_FILE_MAGIC_NUMBER,
+        .version = SCENE_FILE_VERSION,
+        .nodeCount = nodeCount,
+        .sectionCount = sectionCount,
+        .sectionTableOffset = sizeof(SceneFileHeader),
+    };
+
+    std::vector<SceneFileSection> sections(sectionCount);
+    u64 offset = AlignSceneFileOffset(header.sectionTableOffset
+                                      + sizeof(SceneFileSection) * sectionCount);
+    for (u32 i = 0; i < sectionCount; i++)
+    {
+        sections[i] = {
+            .type = sectionData[i].type,
+            .elementSize = sectionData[i].elementSize,
+            .offset = offset,
+            .size = sectionData[i].size,
+        };
+        offset = AlignSceneFileOffset(offset + sectionData[i].size);
+    }
+
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)sections.data(), sizeof(SceneFileSection) * sectionCount);
+
+    u64 position = sizeof(header) + sizeof(SceneFileSection) * sectionCount;
+    const char padding[SCENE_FILE_SECTION_ALIGNMENT]{};
+    for (u32 i = 0; i < sectionCount; i++)
+    {
+        file.write(padding, sections[i].offset - position);
+        file.write((const char*)sectionData[i].data, sections[i].size);
+        position = sections[i].offset + sections[i].size;
+    }
+
+    if (!file.good())
+    {
+        LOG_ERROR("saveScene: failed to write scene data ", fileName);
+        return false;
+    }
+
+    file.close();
 
-    return (newIndices[node] == u32(-1))
-               ? FindLastNonDeletedItem(scene, newIndices, scene.hierarchy[node].nextSibling)
-               : newIndices[node];
+    return true;
 }
 
-// Set map values based on newIndices.
-void ShiftMapIndices(std::unordered_map<u32, u32>& items, const std::vector<u32>& newIndices)
+bool LoadScene(const std::string& fileName, Scene& scene)
 {
-    std::unordered_map<u32, u32> newItems;
-    for (const auto& m : items)
+    scene = Scene{};
+
+    // Shared with the name tables viewing it.
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(fileName))
     {
-        int newIndex = newIndices[m.first];
-        if (newIndex != u32(-1))
-            newItems[newIndex] = m.second;
+        LOG_ERROR("LoadScene: failed to map ", fs::absolute(fileName));
+        return false;
     }
-    items = newItems;
-}
 
-} // namespace
+    const u8* data = file->GetData();
+    const u64 fileSize = file->GetSize();
 
-void MergeScenes(Scene& scene, const std::vector<Scene*>& scenes,
-                 const std::vector<glm::mat4>& rootTransforms, const std::vector<u32>& meshCounts,
-                 bool mergeMeshes, bool mergeMaterials)
+    u32 magicNumber = 0;
+    if (fileSize >= sizeof(magicNumber))
+        memcpy(&magicNumber, data, sizeof(magicNumber));
+
+    // Unversioned files start with the node count.
+    const bool parsed = (magicNumber == SCENE_FILE_MAGIC_NUMBER)
+                            ? ParseSceneFile(fileName, file, scene)
+                            : ParseLegacySceneFile(fileName, data, fileSize, scene);
+
+    if (!parsed || !ValidateScene(fileName, scene))
+    {
+        scene = Scene{};
+        return false;
+    }
+
+    SortComponents(scene.meshIds);
+    SortComponents(scene.materialIds);
+    SortComponents(scene.nameIds);
+
+    scene.globalTransforms.assign(scene.hierarchy.size(), mat4(1.0f));
+    MarkAllAsChanged(scene);
+    RebuildNameIndex(scene);
+
+    return true;
+}
+
+/*
+ * More advanced scene operations.
+ */
+std::vector<u32> ReorderSceneByLevel(Scene& scene)
 {
-    // New root node.
-    scene.hierarchy = {{
-        .parent = u32(-1),
-        .firstChild = 1,
-        .nextSibling = u32(-1),
-        .lastSibling = u32(-1),
-        .level = 0,
-    }};
+    const u32 nodeCount = (u32)scene.hierarchy.size();
 
-    scene.namesMap[0] = 0;
-    scene.names = {"NewRootNode"};
+    // order[newIndex] = oldIndex. Counting sort by level, stable so sibling order is kept within
+    // a level.
+    u32 levelCount = 0;
+    for (const auto& h : scene.hierarchy)
+        levelCount = std::max(levelCount, h.level + 1);
 
-    scene.localTransforms.push_back(glm::mat4(1.f));
-    scene.globalTransforms.push_back(glm::mat4(1.f));
+    std::vector<u32> levelStart(levelCount + 1, 0);
+    for (const auto& h : scene.hierarchy)
+        levelStart[h.level + 1]++;
+    std::partial_sum(levelStart.begin(), levelStart.end(), levelStart.begin());
 
-    if (scenes.empty())
-        return;
+    std::vector<u32> order(nodeCount);
+    for (u32 i = 0; i < nodeCount; i++)
+        order[levelStart[scene.hierarchy[i].level]++] = i;
+
+    std::vector<u32> newIndices(nodeCount);
+    for (u32 i = 0; i < nodeCount; i++)
+        newIndices[order[i]] = i;
 
-    int offs = 1;
-    int meshOffs = 0;
-    int nameOffs = (int)scene.names.size();
-    int materialOfs = 0;
-    auto meshCount = meshCounts.begin();
+    auto remap = [&newIndices](u32 node) {
+        return (node != u32(-1)) ? newIndices[node] : u32(-1);
+    };
 
-    if (!mergeMaterials)
-        scene.materialNames = scenes[0]->materialNames;
+    std::vector<SceneHierarchy> hierarchy(nodeCount);
+    std::vector<mat4> localTransforms(nodeCount);
+    std::vector<mat4> globalTransforms(nodeCount);
+    std::vector<u32> dirtyGeneration(nodeCount, 0);
 
-    for (const auto* s : scenes)
+    for (u32 i = 0; i < nodeCount; i++)
     {
-        MergeVectors(scene.localTransforms, s->localTransforms);
-        MergeVectors(scene.globalTransforms, s->globalTransforms);
+        const auto& h = scene.hierarchy[order[i]];
+        hierarchy[i] = {
+            .parent = remap(h.parent),
+            .firstChild = remap(h.firstChild),
+            .nextSibling = remap(h.nextSibling),
+            .lastSibling = remap(h.lastSibling),
+            .level = h.level,
+        };
+
+        localTransforms[i] = scene.localTransforms[order[i]];
+        globalTransforms[i] = scene.globalTransforms[order[i]];
+        if (order[i] < scene.dirtyGeneration.size())
+            dirtyGeneration[i] = scene.dirtyGeneration[order[i]];
+    }
 
-        MergeVectors(scene.hierarchy, s->hierarchy);
+    scene.hierarchy = std::move(hierarchy);
+    scene.localTransforms = std::move(localTransforms);
+    scene.globalTransforms = std::move(globalTransforms);
+    scene.dirtyGeneration = std::move(dirtyGeneration);
 
-        MergeVectors(scene.names, s->names);
-        if (mergeMaterials)
-            MergeVectors(scene.materialNames, s->materialNames);
+    RemapComponentNodes(scene.meshIds, newIndices);
+    RemapComponentNodes(scene.materialIds, newIndices);
+    RemapComponentNodes(scene.nameIds, newIndices);
 
-        u32 nodeCount = (int)s->hierarchy.size();
+    for (auto& changed : scene.changedAtThisFrame)
+        for (auto& node : changed)
+            node = (int)newIndices[node];
 
-        ShiftNodes(scene, offs, nodeCount, offs);
+    RebuildNameIndex(scene);
 
-        MergeMaps(scene.meshesMap, s->meshesMap, offs, mergeMeshes ? meshOffs : 0);
-        MergeMaps(scene.materialsMap, s->materialsMap, offs, mergeMaterials ? materialOfs : 0);
-        MergeMaps(scene.namesMap, s->namesMap, offs, nameOffs);
+    return newIndices;
+}
 
-        offs += nodeCount;
+bool IsSceneSortedByLevel(const Scene& scene)
+{
+    return std::is_sorted(scene.hierarchy.begin(), scene.hierarchy.end(),
+                          [](const SceneHierarchy& a, const SceneHierarchy& b) {
+                              return a.level < b.level;
+                          });
+}
 
-        materialOfs += (int)s->materialNames.size();
-        nameOffs += (int)s->names.size();
+namespace
+{
 
-        if (mergeMeshes)
+/*
+ * Shared by MergeScenesInto and MergeScenes, which reads its sources in place. The merged node
+ * count of every level is known up front, so every node is written once, straight to its slot in
+ * the level ordered result, instead of being appended and reordered afterwards. With consume, each
+ * source is released as soon as it is merged.
+ */
+void MergeSceneSources(Scene& scene, std::span<Scene* const> sources,
+                       const std::vector<mat4>& rootTransforms, const std::vector<u32>& meshCounts,
+                       u32 firstMeshIndex, bool mergeMeshes, bool mergeMaterials, bool consume)
+{
+    if (scene.hierarchy.empty())
+    {
+        const u32 root = AddNode(scene, u32(-1), 0);
+        SetNodeName(scene, root, "NewRootNode");
+    }
+
+    if (sources.empty())
+        return;
+
+    if (!mergeMaterials && scene.materialNames.empty())
+    {
+        if (consume)
+            scene.materialNames = std::move(sources[0]->materialNames);
+        else
+            scene.materialNames = sources[0]->materialNames;
+    }
+
+    const u32 root = 0;
+    const u32 levelShift = scene.hierarchy[root].level + 1;
+
+    // levelStart[level] is the next free slot of level in the merged scene.
+    u32 levelCount = 0;
+    for (const auto& h : scene.hierarchy)
+        levelCount = std::max(levelCount, h.level + 1);
+    for (const auto* s : sources)
+        for (const auto& h : s->hierarchy)
+            levelCount = std::max(levelCount, h.level + levelShift + 1);
+
+    std::vector<u32> levelStart(levelCount + 1, 0);
+    for (const auto& h : scene.hierarchy)
+        levelStart[h.level + 1]++;
+    for (const auto* s : sources)
+        for (const auto& h : s->hierarchy)
+            levelStart[h.level + levelShift + 1]++;
+    std::partial_sum(levelStart.begin(), levelStart.end(), levelStart.begin());
+
+    const u32 nodeCount = levelStart[levelCount];
+
+    size_t nameCount = scene.names.size();
+    size_t nameCharCount = scene.names.GetCharCount();
+    size_t materialNameCount = scene.materialNames.size();
+    size_t materialNameCharCount = scene.materialNames.GetCharCount();
+    for (const auto* s : sources)
+    {
+        nameCount += s->names.size();
+        nameCharCount += s->names.GetCharCount();
+        materialNameCount += mergeMaterials ? s->materialNames.size() : 0;
+        materialNameCharCount += mergeMaterials ? s->materialNames.GetCharCount() : 0;
+    }
+    scene.names.Reserve(nameCount, nameCharCount);
+    scene.materialNames.Reserve(materialNameCount, materialNameCharCount);
+
+    std::vector<SceneHierarchy> hierarchy(nodeCount);
+    std::vector<mat4> localTransforms(nodeCount);
+    std::vector<mat4> globalTransforms(nodeCount);
+    std::vector<u32> dirtyGeneration(nodeCount, 0);
+    std::vector<u32> meshIds(nodeCount, u32(-1));
+    std::vector<u32> materialIds(nodeCount, u32(-1));
+    std::vector<u32> nameIds(nodeCount, u32(-1));
+
+    // Source roots, linked below the destination root once the merged hierarchy is in place.
+    std::vector<std::pair<u32, size_t>> mergedRoots;
+
+    std::vector<u32> newIndices;
+    auto placeNodes = [&](const Scene& s, u32 levelOffset) {
+        const u32 count = (u32)s.hierarchy.size();
+        newIndices.resize(count);
+        for (u32 i = 0; i < count; i++)
+            newIndices[i] = levelStart[s.hierarchy[i].level + levelOffset]++;
+
+        auto remap = [&newIndices](u32 node) {
+            return (node != u32(-1)) ? newIndices[node] : u32(-1);
+        };
+
+        for (u32 i = 0; i < count; i++)
         {
-            meshOffs += *meshCount;
-            meshCount++;
+            const auto& h = s.hierarchy[i];
+            hierarchy[newIndices[i]] = {
+                .parent = remap(h.parent),
+                .firstChild = remap(h.firstChild),
+                .nextSibling = remap(h.nextSibling),
+                .lastSibling = remap(h.lastSibling),
+                .level = h.level + levelOffset,
+            };
+            localTransforms[newIndices[i]] = s.localTransforms[i];
+            globalTransforms[newIndices[i]] = s.globalTransforms[i];
         }
-    }
+    };
+
+    // The destination keeps its levels, its nodes only move to make room for the merged ones.
+    placeNodes(scene, 0);
+    for (u32 i = 0; i < (u32)std::min(scene.dirtyGeneration.size(), newIndices.size()); i++)
+        dirtyGeneration[newIndices[i]] = scene.dirtyGeneration[i];
+    for (auto& changed : scene.changedAtThisFrame)
+        for (auto& node : changed)
+            node = (int)newIndices[node];
+
+    ScatterComponents(meshIds, scene.meshIds, newIndices, 0);
+    ScatterComponents(materialIds, scene.materialIds, newIndices, 0);
+    ScatterComponents(nameIds, scene.nameIds, newIndices, 0);
 
-    offs = 1;
-    int idx = 0;
-    for (const auto* s : scenes)
+    u32 meshOffset = firstMeshIndex;
+    for (size_t idx = 0; idx < sources.size(); idx++)
     {
-        int nodeCount = (int)s->hierarchy.size();
-        bool isLast = (idx == scenes.size() - 1);
+        auto& s = *sources[idx];
 
-        int next = isLast ? u32(-1) : offs + nodeCount;
-        scene.hierarchy[offs].nextSibling = next;
+        // Empty scenes still own their meshes and materials, later ids are offset past them.
+        const u32 nameOffset = (u32)scene.names.size();
+        const u32 materialOffset = mergeMaterials ? (u32)scene.materialNames.size() : 0;
 
-        scene.hierarchy[offs].parent = 0;
+        scene.names.Append(s.names);
+        if (mergeMaterials)
+            scene.materialNames.Append(s.materialNames);
 
-        if (!rootTransforms.empty())
-            scene.localTransforms[offs] = rootTransforms[idx] * scene.localTransforms[offs];
+        if (!s.hierarchy.empty())
+        {
+            placeNodes(s, levelShift);
 
-        offs += nodeCount;
-        idx++;
+            for (u32 i = 0; i < (u32)s.hierarchy.size(); i++)
+            {
+                if (s.hierarchy[i].parent == u32(-1))
+                {
+                    auto& h = hierarchy[newIndices[i]];
+                    h.nextSibling = u32(-1);
+                    h.lastSibling = u32(-1);
+                    mergedRoots.push_back({newIndices[i], idx});
+                }
+            }
+
+            ScatterComponents(meshIds, s.meshIds, newIndices, mergeMeshes ? meshOffset : 0);
+            ScatterComponents(materialIds, s.materialIds, newIndices, materialOffset);
+            ScatterComponents(nameIds, s.nameIds, newIndices, nameOffset);
+        }
+
+        if (mergeMeshes)
+            meshOffset += meshCounts[idx];
+
+        // Release the source buffers as soon as they are merged.
+        if (consume)
+            s = Scene{};
     }
 
-    for (auto i = scene.hierarchy.begin() + 1; i != scene.hierarchy.end(); i++)
-        i->level++;
+    scene.hierarchy = std::move(hierarchy);
+    scene.localTransforms = std::move(localTransforms);
+    scene.globalTransforms = std::move(globalTransforms);
+    scene.dirtyGeneration = std::move(dirtyGeneration);
+    GatherComponents(scene.meshIds, meshIds);
+    GatherComponents(scene.materialIds, materialIds);
+    GatherComponents(scene.nameIds, nameIds);
+
+    // Every source root becomes a child of the destination root, in source order.
+    for (const auto& [node, idx] : mergedRoots)
+    {
+        LinkChild(scene, root, node);
+
+        if (!rootTransforms.empty())
+            scene.localTransforms[node] = rootTransforms[idx] * scene.localTransforms[node];
+    }
+
+    for (const auto& [node, idx] : mergedRoots)
+        MarkAsChanged(scene, node);
+
+    RebuildNameIndex(scene);
+}
+
+} // namespace
+
+void MergeScenesInto(Scene& scene, std::vector<Scene>&& scenes,
+                     const std::vector<mat4>& rootTransforms, const std::vector<u32>& meshCounts,
+                     u32 firstMeshIndex, bool mergeMeshes, bool mergeMaterials)
+{
+    std::vector<Scene*> sources;
+    sources.reserve(scenes.size());
+    for (auto& s : scenes)
+        sources.push_back(&s);
+
+    MergeSceneSources(scene, sources, rootTransforms, meshCounts, firstMeshIndex, mergeMeshes,
+                      mergeMaterials, true);
+}
+
+void MergeScenes(Scene& scene, const std::vector<Scene*>& scenes,
+                 const std::vector<glm::mat4>& rootTransforms, const std::vector<u32>& meshCounts,
+                 bool mergeMeshes, bool mergeMaterials)
+{
+    scene = Scene{};
+    MergeSceneSources(scene, scenes, rootTransforms, meshCounts, 0, mergeMeshes, mergeMaterials,
+                      false);
 }
 
 /*
- * Approximately an O ( N * Log(N) * Log(M)) algorithm (N = scene.size, M = nodesToDelete.size) to
- * delete a collection of nodes. See:
- * https://github.com/PacktPublishing/3D-Graphics-Rendering-Cookbook/blob/master/shared/scene/Scene.cpp
+ * O(N) deletion of a collection of nodes and their subtrees (N = scene.size):
+ * mark the deleted nodes in a bitmap, relink the surviving siblings and compact every per node
+ * array in a single pass that keeps the relative order, and with it the level order, of nodes.
  */
 void DeleteSceneNodes(Scene& scene, const std::vector<u32>& nodesToDelete)
 {
-    // 0) Add all the nodes down below in the hierarchy
-    auto indicesToDelete = nodesToDelete;
-    for (auto i : indicesToDelete)
-        CollectNodesToDelete(scene, i, indicesToDelete);
+    const u32 oldSize = (u32)scene.hierarchy.size();
+    const auto& hierarchy = scene.hierarchy;
 
-    // aux array with node indices to keep track of the moved ones [moved = [](node) { return (node
-    // != nodes[node]); ]
-    std::vector<u32> nodes(scene.hierarchy.size());
-    std::iota(nodes.begin(), nodes.end(), 0);
+    // 1) Mark the deleted nodes and everything below them.
+    std::vector<u8> deleted(oldSize, 0);
+    std::vector<u32> stack;
+    for (const u32 node : nodesToDelete)
+    {
+        if (node >= oldSize || deleted[node])
+            continue;
+
+        deleted[node] = 1;
+        stack.push_back(node);
 
-    // 1.a) Move all the indicesToDelete to the end of 'nodes' array (and cut them off, a variation
-    // of swap'n'pop for multiple elements)
-    auto oldSize = nodes.size();
-    EraseSelected(nodes, indicesToDelete);
+        while (!stack.empty())
+        {
+            const u32 n = stack.back();
+            stack.pop_back();
+
+            for (u32 c = hierarchy[n].firstChild; c != u32(-1); c = hierarchy[c].nextSibling)
+            {
+                if (!deleted[c])
+                {
+                    deleted[c] = 1;
+                    stack.push_back(c);
+                }
+            }
+        }
+    }
 
-    // 1.b) Make a newIndices[oldIndex] mapping table
+    // 2) newIndices[oldIndex] of the surviving nodes.
     std::vector<u32> newIndices(oldSize, u32(-1));
-    for (int i = 0; i < nodes.size(); i++)
-        newIndices[nodes[i]] = i;
-
-    // 2) Replace all non-null parent/firstChild/nextSibling pointers in all the nodes by new
-    // positions
-    auto nodeMover = [&scene, &newIndices](SceneHierarchy& h) {
-        return SceneHierarchy{
-            .parent = (h.parent != u32(-1)) ? newIndices[h.parent] : u32(-1),
-            .firstChild = FindLastNonDeletedItem(scene, newIndices, h.firstChild),
-            .nextSibling = FindLastNonDeletedItem(scene, newIndices, h.nextSibling),
-            .lastSibling = FindLastNonDeletedItem(scene, newIndices, h.lastSibling)};
-    };
-    std::transform(scene.hierarchy.begin(), scene.hierarchy.end(), scene.hierarchy.begin(),
-                   nodeMover);
+    u32 newSize = 0;
+    for (u32 i = 0; i < oldSize; i++)
+        if (!deleted[i])
+            newIndices[i] = newSize++;
+
+    if (newSize == oldSize)
+        return;
+
+    // 3) Relink the surviving nodes. Every sibling chain is walked once, the first child keeps
+    // the last sibling of its chain as AddNode does.
+    std::vector<SceneHierarchy> newHierarchy(newSize);
+    for (u32 i = 0; i < oldSize; i++)
+    {
+        if (deleted[i])
+            continue;
+
+        const auto& h = hierarchy[i];
+        auto& nh = newHierarchy[newIndices[i]];
+
+        nh.parent = (h.parent != u32(-1)) ? newIndices[h.parent] : u32(-1);
+        nh.level = h.level;
+
+        u32 first = u32(-1);
+        u32 last = u32(-1);
+        for (u32 c = h.firstChild; c != u32(-1); c = hierarchy[c].nextSibling)
+        {
+            if (deleted[c])
+                continue;
+
+            if (last == u32(-1))
+                first = newIndices[c];
+            else
+                newHierarchy[last].nextSibling = newIndices[c];
+
+            last = newIndices[c];
+        }
 
-    // 3) Finally throw away the hierarchy items
-    EraseSelected(scene.hierarchy, indicesToDelete);
+        nh.firstChild = first;
+        if (first != u32(-1))
+            newHierarchy[first].lastSibling = last;
 
-    // 4) As in mergeScenes() routine we also have to adjust all the "components" (i.e., meshesMap,
-    // materials, names and transformations)
+        // Root nodes are not in any parent's chain, skip over deleted roots following them.
+        if (h.parent == u32(-1))
+        {
+            u32 next = h.nextSibling;
+            while (next != u32(-1) && deleted[next])
+                next = hierarchy[next].nextSibling;
 
-    // 4a) Transformations are stored in arrays, so we just erase the items as we did with the
-    // scene.hierarchy
-    EraseSelected(scene.localTransforms, indicesToDelete);
-    EraseSelected(scene.globalTransforms, indicesToDelete);
+            nh.nextSibling = (next != u32(-1)) ? newIndices[next] : u32(-1);
+        }
+    }
 
-    // 4b) All the maps should change the key values with the newIndices[] array
-    ShiftMapIndices(scene.meshesMap, newIndices);
-    ShiftMapIndices(scene.materialsMap, newIndices);
-    ShiftMapIndices(scene.namesMap, newIndices);
+    scene.hierarchy = std::move(newHierarchy);
 
-    // 5) scene node names list is not modified, but in principle it can be (remove all non-used
-    // items and adjust the namesMap map)
+    // 4) Compact the per node arrays in place.
+    const bool hasDirtyGeneration = (scene.dirtyGeneration.size() == oldSize);
+    for (u32 i = 0; i < oldSize; i++)
+    {
+        const u32 newIndex = newIndices[i];
+        if (newIndex == u32(-1) || newIndex == i)
+            continue;
+
+        scene.localTransforms[newIndex] = scene.localTransforms[i];
+        scene.globalTransforms[newIndex] = scene.globalTransforms[i];
+        if (hasDirtyGeneration)
+            scene.dirtyGeneration[newIndex] = scene.dirtyGeneration[i];
+    }
+
+    scene.localTransforms.resize(newSize);
+    scene.globalTransforms.resize(newSize);
+    scene.dirtyGeneration.resize(hasDirtyGeneration ? newSize : 0);
+
+    // 5) Components and queued nodes follow the new indices, deleted ones are dropped.
+    RemapComponentNodes(scene.meshIds, newIndices);
+    RemapComponentNodes(scene.materialIds, newIndices);
+    RemapComponentNodes(scene.nameIds, newIndices);
+    RebuildNameIndex(scene);
+
+    for (auto& changed : scene.changedAtThisFrame)
+    {
+        std::erase_if(changed, [&newIndices](int node) { return newIndices[node] == u32(-1); });
+        for (auto& node : changed)
+            node = (int)newIndices[node];
+    }
 
-    // 6) Material names list is not modified also, but if some
-    // materials fell out of use, remove them completely.
+    // Scene node names and material names are not modified, unused entries are kept.
 }
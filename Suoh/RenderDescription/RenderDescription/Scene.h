@@ -1,8 +1,12 @@
 #pragma once
 
 #include <CoreTypes.h>
+#include <StringTable.h>
 
-#include <unordered_map>
+#include "SceneComponents.h"
+
+#include <string>
+#include <string_view>
 #include <vector>
 
 constexpr auto MAX_SCENE_LEVEL = 16;
@@ -16,6 +20,24 @@ struct SceneHierarchy
     u32 level{0};
 };
 
+/*
+ * Open addressing name -> node index. Slots are not removed on rename, lookups check the current
+ * node name and skip stale slots until the next rebuild drops them.
+ */
+struct SceneNameIndex
+{
+    // 8 bytes, so a slot array of twice the named node count stays small and cache friendly.
+    struct Slot
+    {
+        // High half of the name hash, the low half selects the slot.
+        u32 hash{0};
+        u32 node{u32(-1)};
+    };
+
+    std::vector<Slot> slots;
+    u32 usedSlotCount{0};
+};
+
 // XXX: Use handle/strong typed ints for scene/node indices.
 struct Scene
 {
@@ -24,40 +46,146 @@ struct Scene
 
     std::vector<SceneHierarchy> hierarchy;
 
-    std::unordered_map<u32, u32> meshesMap;
-    std::unordered_map<u32, u32> materialsMap;
-    std::unordered_map<u32, u32> namesMap;
+    // Per node mesh, material and names[] indices.
+    SceneComponents meshIds;
+    SceneComponents materialIds;
+    SceneComponents nameIds;
+
+    StringTable names;
+    StringTable materialNames;
 
-    std::vector<std::string> names;
-    std::vector<std::string> materialNames;
+    // Maintained by SetNodeName, rebuilt when nodes are loaded, merged, reordered or deleted.
+    SceneNameIndex nameIndex;
 
     std::vector<int> changedAtThisFrame[MAX_SCENE_LEVEL];
+
+    // Nodes whose dirtyGeneration equals currentGeneration are already in changedAtThisFrame.
+    std::vector<u32> dirtyGeneration;
+    u32 currentGeneration{1};
 };
 
-inline std::string GetNodeName(const Scene& scene, u32 node)
+inline std::string_view GetNodeName(const Scene& scene, u32 node)
 {
-    u32 id = scene.namesMap.contains(node) ? scene.namesMap.at(node) : u32(-1);
-    return (id > u32(-1)) ? scene.names[id] : std::string();
+    u32 id = GetComponent(scene.nameIds, node);
+    return (id != u32(-1)) ? scene.names[id] : std::string_view();
 }
 
-inline void SetNodeName(Scene& scene, u32 node, const std::string& name)
-{
-    u32 id = (u32)scene.names.size();
-    scene.names.push_back(name);
-    scene.namesMap[node] = id;
-}
+void SetNodeName(Scene& scene, u32 node, std::string_view name);
+void RebuildNameIndex(Scene& scene);
 
+// Nodes added below a node queued this frame are queued as well.
 u32 AddNode(Scene& scene, u32 parent, u32 level);
-void RecalculateGlobalTransforms(Scene& scene);
 
+/*
+ * Updates the global transforms of every node in changedAtThisFrame, one level at a time. Levels
+ * with many changed nodes are updated in parallel.
+ * Returns the number of updated nodes.
+ */
+u32 RecalculateGlobalTransforms(Scene& scene);
+
+/*
+ * Reorders nodes by level so parents come before their children and every level is contiguous.
+ * Node links, transforms, component maps and changed lists are remapped.
+ * Returns the new index of every old node.
+ */
+std::vector<u32> ReorderSceneByLevel(Scene& scene);
+bool IsSceneSortedByLevel(const Scene& scene);
+
+/*
+ * Appends scenes under the root node of scene, creating the root if scene is empty. Every root of
+ * a source becomes a child of the root and its subtree is queued for RecalculateGlobalTransforms.
+ * The sources are consumed, each one is released as soon as it is merged.
+ * With mergeMeshes, mesh ids of scenes[i] are offset by firstMeshIndex plus the meshCounts of the
+ * scenes before it, empty scenes included. With mergeMaterials, material ids are offset by the
+ * material names before.
+ * Nodes are written straight to their slot in the level ordered result.
+ */
+void MergeScenesInto(Scene& scene, std::vector<Scene>&& scenes,
+                     const std::vector<mat4>& rootTransforms, const std::vector<u32>& meshCounts,
+                     u32 firstMeshIndex = 0, bool mergeMeshes = true, bool mergeMaterials = true);
+
+// Replaces scene with a new root and scenes merged below it, reading them in place.
 void MergeScenes(Scene& scene, const std::vector<Scene*>& scenes,
                  const std::vector<mat4>& rootTransforms, const std::vector<u32>& meshCounts,
                  bool mergeMeshes = true, bool mergeMaterials = true);
 void DeleteSceneNodes(Scene& scene, const std::vector<u32>& nodesToDelete);
 
-void MarkAsChanged(Scene& scene, u32 node);
-u32 FindNodeByName(const Scene& scene, u32 node);
+/*
+ * Queues node and its subtree for RecalculateGlobalTransforms. Nodes already queued since the last
+ * recalculation are skipped along with their subtree.
+ * Returns the number of newly queued nodes.
+ */
+u32 MarkAsChanged(Scene& scene, u32 node);
+// Returns the lowest node index named name, or u32(-1).
+u32 FindNodeByName(const Scene& scene, std::string_view name);
 u32 GetNodeLevel(const Scene& scene, u32 node);
 
+/*
+ * Queues every node for RecalculateGlobalTransforms. Level ordered scenes fill every level with a
+ * contiguous range of nodes.
+ */
+void MarkAllAsChanged(Scene& scene);
+
+/*
+ * Scene file layout (version 2):
+ *   SceneFileHeader | SceneFileSection table | section payloads
+ * Nodes are stored in level order and every payload starts at a SCENE_FILE_SECTION_ALIGNMENT
+ * aligned offset, so each section is read with a single copy out of the file mapping. Global
+ * transforms are not stored, loading queues every node to recalculate them.
+ * Readers skip section types they do not know.
+ */
+constexpr u32 SCENE_FILE_VERSION = 2;
+constexpr u64 SCENE_FILE_SECTION_ALIGNMENT = 64;
+
+enum class SceneFileSectionType : u32
+{
+    LOCAL_TRANSFORMS = 0,
+    HIERARCHY = 1,
+    // Component node and value arrays, sorted by node.
+    MESH_ID_NODES = 2,
+    MESH_ID_VALUES = 3,
+    MATERIAL_ID_NODES = 4,
+    MATERIAL_ID_VALUES = 5,
+    NAME_ID_NODES = 6,
+    NAME_ID_VALUES = 7,
+    // Serialized StringTables, viewed in place. Version 1 used length prefixed string arrays.
+    NAMES = 8,
+    MATERIAL_NAMES = 9,
+};
+
+struct SceneFileSection
+{
+    SceneFileSectionType type;
+    u32 elementSize;
+
+    // Absolute offset and size in bytes.
+    u64 offset;
+    u64 size;
+};
+
+struct SceneFileHeader
+{
+    u32 magicNumber;
+    u32 version;
+
+    u32 nodeCount;
+    u32 sectionCount;
+
+    // Offset to the section table.
+    u64 sectionTableOffset;
+};
+
+static_assert(sizeof(SceneFileSection) == 24, "SceneFileSection must be tightly packed!");
+static_assert(sizeof(SceneFileHeader) == 24, "SceneFileHeader must be tightly packed!");
+static_assert(sizeof(SceneHierarchy) == 20, "SceneHierarchy must be tightly packed!");
+
+// Scenes that are not in level order are reordered before saving.
 bool SaveScene(const std::string& fileName, Scene& scene);
+
+/*
+ * Loads versioned and unversioned scene files. Node links, levels and components are validated,
+ * and every node is queued for RecalculateGlobalTransforms.
+ * Names of version 2 files are viewed straight out of the file mapping, which stays alive as long
+ * as the scene names reference it.
+ */
 bool LoadScene(const std::string& fileName, Scene& scene);
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <CoreTypes.h>
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+/*
+ * Sparse set of one u32 component (mesh, material or name id) per scene node.
+ * Components are stored densely and sorted by node, so iteration is linear and ordered by node.
+ * sparse[node] is the dense index of the node's component, or u32(-1).
+ */
+struct SceneComponents
+{
+    std::vector<u32> sparse;
+    std::vector<u32> nodes;
+    std::vector<u32> values;
+
+    size_t size() const
+    {
+        return nodes.size();
+    }
+
+    bool empty() const
+    {
+        return nodes.empty();
+    }
+};
+
+inline bool HasComponent(const SceneComponents& components, u32 node)
+{
+    return node < components.sparse.size() && components.sparse[node] != u32(-1);
+}
+
+// Returns the component of node, or u32(-1).
+inline u32 GetComponent(const SceneComponents& components, u32 node)
+{
+    return HasComponent(components, node) ? components.values[components.sparse[node]] : u32(-1);
+}
+
+inline void ClearComponents(SceneComponents& components)
+{
+    components.sparse.clear();
+    components.nodes.clear();
+    components.values.clear();
+}
+
+/*
+ * Rebuilds sparse from nodes and values after sorting them by node.
+ */
+inline void SortComponents(SceneComponents& components)
+{
+    if (!std::is_sorted(components.nodes.begin(), components.nodes.end()))
+    {
+        std::vector<u32> order(components.nodes.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&components](u32 a, u32 b) {
+            return components.nodes[a] < components.nodes[b];
+        });
+
+        std::vector<u32> nodes(order.size());
+        std::vector<u32> values(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            nodes[i] = components.nodes[order[i]];
+            values[i] = components.values[order[i]];
+        }
+
+        components.nodes = std::move(nodes);
+        components.values = std::move(values);
+    }
+
+    const u32 sparseSize = components.nodes.empty() ? 0 : components.nodes.back() + 1;
+    components.sparse.assign(std::max((size_t)sparseSize, components.sparse.size()), u32(-1));
+    for (u32 i = 0; i < (u32)components.nodes.size(); i++)
+        components.sparse[components.nodes[i]] = i;
+}
+
+/*
+ * Adds or replaces the component of node. Nodes added in increasing order keep the dense arrays
+ * sorted without extra work.
+ */
+inline void SetComponent(SceneComponents& components, u32 node, u32 value)
+{
+    if (HasComponent(components, node))
+    {
+        components.values[components.sparse[node]] = value;
+        return;
+    }
+
+    if (node >= components.sparse.size())
+        components.sparse.resize(node + 1, u32(-1));
+
+    const bool keepsOrder = components.nodes.empty() || components.nodes.back() < node;
+
+    components.sparse[node] = (u32)components.nodes.size();
+    components.nodes.push_back(node);
+    components.values.push_back(value);
+
+    if (!keepsOrder)
+        SortComponents(components);
+}
+
+// Sets nodeValues[newIndices[node]] for every component of node, adding valueOffset to the value.
+inline void ScatterComponents(std::vector<u32>& nodeValues, const SceneComponents& components,
+                              const std::vector<u32>& newIndices, u32 valueOffset)
+{
+    for (size_t i = 0; i < components.nodes.size(); i++)
+        nodeValues[newIndices[components.nodes[i]]] = components.values[i] + valueOffset;
+}
+
+// Rebuilds components from one value per node, u32(-1) for none. Linear, no sorting needed.
+inline void GatherComponents(SceneComponents& components, const std::vector<u32>& nodeValues)
+{
+    ClearComponents(components);
+    components.sparse.assign(nodeValues.size(), u32(-1));
+
+    for (u32 node = 0; node < (u32)nodeValues.size(); node++)
+    {
+        if (nodeValues[node] == u32(-1))
+            continue;
+
+        components.sparse[node] = (u32)components.nodes.size();
+        components.nodes.push_back(node);
+        components.values.push_back(nodeValues[node]);
+    }
+}
+
+/*
+ * Moves components to newIndices[node], dropping nodes mapped to u32(-1).
+ */
+inline void RemapComponentNodes(SceneComponents& components, const std::vector<u32>& newIndices)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < components.nodes.size(); i++)
+    {
+        const u32 newNode = newIndices[components.nodes[i]];
+        if (newNode == u32(-1))
+            continue;
+
+        components.nodes[count] = newNode;
+        components.values[count] = components.values[i];
+        count++;
+    }
+
+    components.nodes.resize(count);
+    components.values.resize(count);
+    components.sparse.clear();
+
+    SortComponents(components);
+}
@@ -1,5 +1,7 @@
 #include "Utils.h"
 
+#include <cstring>
+
 void SaveStringArray(std::ofstream& file, const std::vector<std::string>& arr)
 {
     u32 size = arr.size();
@@ -29,31 +31,53 @@ void LoadStringArray(std::ifstream& file, std::vector<std::string>& arr)
     }
 }
 
-void SaveMap(std::ofstream& file, const std::unordered_map<u32, u32>& map)
+void LoadStringArray(std::ifstream& file, StringTable& strings)
 {
-    std::vector<u32> ms;
-    ms.reserve(map.size() * 2);
+    u32 count = 0;
+    file.read((char*)&count, sizeof(u32));
 
-    for (const auto& m : map)
-    {
-        ms.push_back(m.first);
-        ms.push_back(m.second);
-    }
+    strings.Clear();
 
-    const u32 size = static_cast<u32>(ms.size());
+    std::vector<char> inBytes;
+    for (u32 i = 0; i < count && file; i++)
+    {
+        u32 size = 0;
+        file.read((char*)&size, sizeof(u32));
+        inBytes.resize(size + 1);
+        file.read((char*)inBytes.data(), size + 1);
 
-    file.write((char*)&size, sizeof(size));
-    file.write((char*)ms.data(), sizeof(u32) * ms.size());
+        strings.Add(std::string_view(inBytes.data(), size));
+    }
 }
 
-void LoadMap(std::ifstream& file, std::unordered_map<u32, u32>& map)
+bool UnpackStringArray(std::span<const u8> data, StringTable& strings)
 {
-    u32 size = 0;
-    file.read((char*)&size, sizeof(size));
+    u64 offset = 0;
+    auto readU32 = [&data, &offset](u32& value) {
+        if (offset + sizeof(u32) > data.size())
+            return false;
+
+        memcpy(&value, data.data() + offset, sizeof(u32));
+        offset += sizeof(u32);
+        return true;
+    };
+
+    u32 count = 0;
+    if (!readU32(count) || count > data.size() / sizeof(u32))
+        return false;
 
-    std::vector<u32> ms(size);
-    file.read((char*)ms.data(), sizeof(u32) * size);
+    strings.Clear();
+    strings.Reserve(count, data.size() - offset);
+
+    for (u32 i = 0; i < count; i++)
+    {
+        u32 length = 0;
+        if (!readU32(length) || offset + length + 1 > data.size())
+            return false;
+
+        strings.Add(std::string_view((const char*)data.data() + offset, length));
+        offset += length + 1;
+    }
 
-    for (auto i = 0; i < (size / 2); i++)
-        map[ms[i * 2]] = ms[(i * 2) + 1];
+    return true;
 }
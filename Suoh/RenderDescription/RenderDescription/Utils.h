@@ -1,20 +1,22 @@
 #pragma once
 
 #include <fstream>
+#include <span>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include <CoreTypes.h>
+#include <StringTable.h>
 
 /*
  * File save helpers.
  */
 void SaveStringArray(std::ofstream& file, const std::vector<std::string>& arr);
 void LoadStringArray(std::ifstream& file, std::vector<std::string>& arr);
+void LoadStringArray(std::ifstream& file, StringTable& strings);
 
-void SaveMap(std::ofstream& file, const std::unordered_map<u32, u32>& map);
-void LoadMap(std::ifstream& file, std::unordered_map<u32, u32>& map);
+// Reads the string array layout out of memory, e.g. a file mapping.
+bool UnpackStringArray(std::span<const u8> data, StringTable& strings);
 
 /*
  * Adds if name is not in array.
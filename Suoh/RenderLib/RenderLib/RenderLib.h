@@ -17,7 +17,8 @@ struct DeviceDesc
     u32 framebufferWidth;
     u32 framebufferHeight;
 
-    void* glfwWindowPtr;
+    // Null creates a headless device without surface, swapchain or presentation.
+    void* glfwWindowPtr{nullptr};
 };
 
 namespace Vulkan
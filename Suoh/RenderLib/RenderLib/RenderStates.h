@@ -18,6 +18,7 @@ enum class BufferUsage : u32
     // TRANSFER_SOURCE = 0X00000020,
     // TRANSFER_DESTINATION = 0X00000040,
 };
+ENUM_CLASS_FLAG_OPERATORS(BufferUsage);
 
 enum class CpuAccessMode : u8
 {
@@ -30,7 +31,7 @@ enum class QueueType
 {
     GRAPHICS = 0,
     COMPUTE = 1,
-    // TRANSFER = 2,
+    TRANSFER = 2,
 };
 
 } // namespace RenderLib
\ No newline at end of file
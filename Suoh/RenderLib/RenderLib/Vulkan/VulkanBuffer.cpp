@@ -33,17 +33,35 @@ BufferHandle VulkanDevice::CreateBuffer(const BufferDesc& desc)
                           .setSharingMode(vk::SharingMode::eExclusive)
                           .setPNext(0);
 
+    // Shared with the async compute and transfer queues without ownership transfers.
+    std::vector<u32> queueFamilies{m_GraphicsFamily};
+    if (HasAsyncCompute())
+        queueFamilies.push_back(m_ComputeFamily);
+    if (HasTransferQueue() && m_TransferFamily != m_ComputeFamily)
+        queueFamilies.push_back(m_TransferFamily);
+
+    if (queueFamilies.size() > 1)
+    {
+        bufferInfo.setSharingMode(vk::SharingMode::eConcurrent)
+            .setQueueFamilyIndices(queueFamilies);
+    }
+
     VmaAllocationCreateInfo allocInfo{};
-    if (desc.usage == BufferUsage::UNIFORM_BUFFER || desc.cpuAccess == CpuAccessMode::WRITE)
+    if ((desc.usage & BufferUsage::UNIFORM_BUFFER) != 0 || desc.cpuAccess == CpuAccessMode::WRITE)
     {
         // Get OUT OF MEMORY if flags are used manually.
         // allocInfo.flags
         //     = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
         allocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
     }
+    else if (desc.cpuAccess == CpuAccessMode::READ)
+    {
+        // Written by the device, read back after the submission finished.
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_TO_CPU;
+    }
     else
     {
-        allocInfo.flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
     }
 
     auto res = vmaCreateBuffer(
@@ -11,13 +11,14 @@ namespace Vulkan
 
 CommandList::CommandList(const VulkanContext& context, VulkanDevice* device,
                          const CommandListDesc& desc)
-    : desc(desc), m_Context(context), m_pDevice(device), m_UploadManager(device)
+    : desc(desc), m_Context(context), m_pDevice(device)
 {
     InitCommandBuffer();
 }
 
 CommandList::~CommandList()
 {
+    ReleaseStaging();
     m_Context.device.destroyCommandPool(m_CommandPool);
 }
 
@@ -28,6 +29,9 @@ CommandListHandle VulkanDevice::CreateCommandList(const CommandListDesc& desc)
 
 void CommandList::Begin()
 {
+    // Staging of a recording that was never submitted.
+    ReleaseStaging();
+
     m_CommandBuffer.reset();
 
     auto beginInfo
@@ -43,7 +47,7 @@ void CommandList::End()
     m_CommandBuffer.end();
 }
 
-void CommandList::CopyBuffer(Buffer* src, Buffer* dst, u32 size, u32 srcOffset, u32 dstOffset)
+void CommandList::CopyBuffer(Buffer* src, Buffer* dst, u64 size, u64 srcOffset, u64 dstOffset)
 {
     auto copyParams
         = vk::BufferCopy().setSrcOffset(srcOffset).setDstOffset(dstOffset).setSize(size);
@@ -51,49 +55,104 @@ void CommandList::CopyBuffer(Buffer* src, Buffer* dst, u32 size, u32 srcOffset,
     m_CommandBuffer.copyBuffer(src->buffer, dst->buffer, 1, &copyParams);
 }
 
-void CommandList::CopyBufferToImage(Buffer* buffer, Image* image)
+void CommandList::CopyBufferToImage(Buffer* buffer, Image* image, u64 bufferOffset,
+                                    u32 mipLevel)
 {
     assert(image->currentLayout == vk::ImageLayout::eTransferDstOptimal);
 
+    const auto mipWidth = std::max(image->desc.width >> mipLevel, 1u);
+    const auto mipHeight = std::max(image->desc.height >> mipLevel, 1u);
+
     auto imageCopy = vk::BufferImageCopy()
-                         .setBufferOffset(0)
+                         .setBufferOffset(bufferOffset)
                          .setBufferRowLength(0)
                          .setBufferImageHeight(0)
                          .setImageSubresource(vk::ImageSubresourceLayers()
                                                   .setAspectMask(vk::ImageAspectFlagBits::eColor)
-                                                  .setMipLevel(0)
+                                                  .setMipLevel(mipLevel)
                                                   .setBaseArrayLayer(0)
                                                   .setLayerCount(image->desc.layerCount))
                          .setImageOffset(vk::Offset3D().setX(0).setY(0).setZ(0))
                          .setImageExtent(vk::Extent3D()
-                                             .setWidth(image->desc.width)
-                                             .setHeight(image->desc.height)
+                                             .setWidth(mipWidth)
+                                             .setHeight(mipHeight)
                                              .setDepth(1));
 
     m_CommandBuffer.copyBufferToImage(buffer->buffer, image->image,
                                       vk::ImageLayout::eTransferDstOptimal, imageCopy);
 }
 
-void CommandList::WriteBuffer(Buffer* buffer, const void* data, u32 size, u32 dstOffset)
+bool CommandList::WriteBuffer(Buffer* buffer, const void* data, u64 size, u64 dstOffset)
 {
-    auto chunk = m_UploadManager.GetChunk();
+    StagingAllocation staging;
+    if (!m_pDevice->GetUploadManager().Allocate(size, STAGING_ALIGNMENT, staging))
+        return false;
+    m_StagingTickets.push_back(staging.ticket);
+
+    memcpy(staging.mappedMemory, data, size);
+    CopyBuffer(staging.buffer, buffer, size, staging.offset, dstOffset);
 
-    memcpy(chunk->mappedMemory, data, size);
-    CopyBuffer(chunk->buffer, buffer, size, 0, dstOffset);
+    return true;
 }
 
-void CommandList::WriteImage(Image* image, const void* data)
+void CommandList::FillBuffer(Buffer* buffer, u32 value, u64 size, u64 dstOffset)
 {
-    VkDeviceSize layerSize
-        = image->desc.width * image->desc.height * BytesPerTexFormat(image->desc.format);
-    VkDeviceSize imageSize = layerSize * image->desc.layerCount;
+    m_CommandBuffer.fillBuffer(buffer->buffer, dstOffset, size, value);
+}
 
-    auto chunk = m_UploadManager.GetChunk();
-    memcpy(chunk->mappedMemory, data, imageSize);
+bool CommandList::WriteImage(Image* image, const void* data)
+{
+    const ImageMipData mip = {
+        .data = data,
+        .size = image->GetMipSize(0),
+    };
 
-    TransitionImageLayout(image, vk::ImageLayout::eTransferDstOptimal);
-    CopyBufferToImage(chunk->buffer, image);
-    TransitionImageLayout(image, vk::ImageLayout::eShaderReadOnlyOptimal);
+    return WriteImageMips(image, {&mip, 1});
+}
+
+bool CommandList::WriteImageMips(Image* image, std::span<const ImageMipData> mips,
+                                 bool transitionLayout)
+{
+    assert(mips.size() <= image->desc.mipLevels);
+
+    // Every mip is staged at an offset aligned to the largest texel block size.
+    u64 stagingSize = 0;
+    for (const auto& mip : mips)
+        stagingSize = (stagingSize + mip.size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+
+    StagingAllocation staging;
+    if (!m_pDevice->GetUploadManager().Allocate(stagingSize, STAGING_ALIGNMENT, staging))
+        return false;
+    m_StagingTickets.push_back(staging.ticket);
+
+    if (transitionLayout)
+        TransitionImageLayout(image, vk::ImageLayout::eTransferDstOptimal);
+    assert(image->currentLayout == vk::ImageLayout::eTransferDstOptimal);
+
+    u64 offset = 0;
+    for (u32 level = 0; level < mips.size(); level++)
+    {
+        memcpy((u8*)staging.mappedMemory + offset, mips[level].data, mips[level].size);
+        CopyBufferToImage(staging.buffer, image, staging.offset + offset, level);
+
+        offset = (offset + mips[level].size + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+    }
+
+    if (transitionLayout)
+        TransitionImageLayout(image, vk::ImageLayout::eShaderReadOnlyOptimal);
+
+    return true;
+}
+
+std::vector<u64> CommandList::TakeStagingTickets()
+{
+    return std::exchange(m_StagingTickets, {});
+}
+
+void CommandList::ReleaseStaging()
+{
+    if (!m_StagingTickets.empty())
+        m_pDevice->GetUploadManager().Submit(TakeStagingTickets(), desc.queueType, 0);
 }
 
 void CommandList::SetGraphicsState(const GraphicsState& graphicsState)
@@ -154,6 +213,66 @@ void CommandList::DrawIndirect(u32 offset, u32 drawCount)
                                  sizeof(vk::DrawIndirectCommand));
 }
 
+void CommandList::DrawIndirectCount(u32 offset, u32 countOffset, u32 maxDrawCount)
+{
+    assert(m_CurrentGraphicsState.indirectBuffer != nullptr);
+    assert(m_CurrentGraphicsState.indirectCountBuffer != nullptr);
+
+    m_CommandBuffer.drawIndirectCount(m_CurrentGraphicsState.indirectBuffer->buffer, offset,
+                                      m_CurrentGraphicsState.indirectCountBuffer->buffer,
+                                      countOffset, maxDrawCount,
+                                      sizeof(vk::DrawIndirectCommand));
+}
+
+void CommandList::SetComputeState(const ComputeState& computeState)
+{
+    m_CommandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                                 computeState.pipeline->pipeline);
+    m_CommandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                       computeState.pipeline->pipelineLayout, 0,
+                                       computeState.descriptorSet->descriptorSet, nullptr);
+
+    m_CurrentComputeState = computeState;
+}
+
+void CommandList::PushComputeConstants(const void* data, u32 size, u32 offset)
+{
+    assert(m_CurrentComputeState.pipeline != nullptr);
+
+    m_CommandBuffer.pushConstants(m_CurrentComputeState.pipeline->pipelineLayout,
+                                  vk::ShaderStageFlagBits::eCompute, offset, size, data);
+}
+
+void CommandList::Dispatch(u32 groupCountX, u32 groupCountY, u32 groupCountZ)
+{
+    assert(m_CurrentComputeState.pipeline != nullptr);
+
+    m_CommandBuffer.dispatch(groupCountX, groupCountY, groupCountZ);
+}
+
+void CommandList::DispatchIndirect(Buffer* buffer, u64 offset)
+{
+    assert(m_CurrentComputeState.pipeline != nullptr);
+
+    m_CommandBuffer.dispatchIndirect(buffer->buffer, offset);
+}
+
+void CommandList::BufferBarrier(Buffer* buffer, vk::PipelineStageFlags srcStage,
+                                vk::AccessFlags srcAccess, vk::PipelineStageFlags dstStage,
+                                vk::AccessFlags dstAccess)
+{
+    const auto barrier = vk::BufferMemoryBarrier()
+                             .setSrcAccessMask(srcAccess)
+                             .setDstAccessMask(dstAccess)
+                             .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                             .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+                             .setBuffer(buffer->buffer)
+                             .setOffset(0)
+                             .setSize(VK_WHOLE_SIZE);
+
+    m_CommandBuffer.pipelineBarrier(srcStage, dstStage, vk::DependencyFlags(), {}, barrier, {});
+}
+
 void CommandList::InitCommandBuffer()
 {
     u32 queueFamily = 0;
@@ -162,6 +281,8 @@ void CommandList::InitCommandBuffer()
     else if (desc.queueType == QueueType::COMPUTE)
 
         queueFamily = m_pDevice->GetComputeFamily();
+    else if (desc.queueType == QueueType::TRANSFER)
+        queueFamily = m_pDevice->GetTransferFamily();
     else
     {
         LOG_ERROR("InitCommandBuffer: invalid queue type!");
@@ -213,11 +334,14 @@ void CommandList::EndRenderPass()
     //}
 }
 
-void CommandList::TransitionImageLayout(Image* image, vk::ImageLayout newLayout)
+namespace
 {
-    if (image->currentLayout == newLayout)
-        return;
 
+// Barrier moving the whole image from its current layout to newLayout, and the stages it waits on.
+vk::ImageMemoryBarrier GetLayoutTransition(const Image* image, vk::ImageLayout newLayout,
+                                           vk::PipelineStageFlags& sourceStage,
+                                           vk::PipelineStageFlags& destinationStage)
+{
     auto oldLayout = image->currentLayout;
     auto format = image->desc.format;
 
@@ -250,9 +374,6 @@ void CommandList::TransitionImageLayout(Image* image, vk::ImageLayout newLayout)
         barrier.subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
     }
 
-    vk::PipelineStageFlags sourceStage;
-    vk::PipelineStageFlags destinationStage;
-
     if (oldLayout == vk::ImageLayout::eUndefined
         && newLayout == vk::ImageLayout::eShaderReadOnlyOptimal)
     {
@@ -354,11 +475,44 @@ void CommandList::TransitionImageLayout(Image* image, vk::ImageLayout newLayout)
         destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
     }
 
-    m_CommandBuffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags(), {}, {},
-                                    barrier);
+    return barrier;
+}
 
-    // XXX: Is it safe to do this without submitting the command buffer?
-    image->currentLayout = newLayout;
+} // namespace
+
+void CommandList::TransitionImageLayout(Image* image, vk::ImageLayout newLayout)
+{
+    TransitionImageLayouts({&image, 1}, newLayout);
+}
+
+void CommandList::TransitionImageLayouts(std::span<Image* const> images, vk::ImageLayout newLayout)
+{
+    vk::PipelineStageFlags sourceStage;
+    vk::PipelineStageFlags destinationStage;
+    std::vector<vk::ImageMemoryBarrier> barriers;
+
+    for (auto image : images)
+    {
+        if (image->currentLayout == newLayout)
+            continue;
+
+        vk::PipelineStageFlags imageSourceStage;
+        vk::PipelineStageFlags imageDestinationStage;
+        barriers.push_back(
+            GetLayoutTransition(image, newLayout, imageSourceStage, imageDestinationStage));
+
+        sourceStage |= imageSourceStage;
+        destinationStage |= imageDestinationStage;
+
+        // XXX: Is it safe to do this without submitting the command buffer?
+        image->currentLayout = newLayout;
+    }
+
+    if (barriers.empty())
+        return;
+
+    m_CommandBuffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags(), {}, {},
+                                    barriers);
 }
 
 } // namespace Vulkan
@@ -3,16 +3,22 @@
 #include "VulkanCommon.h"
 
 #include "VulkanBindings.h"
+#include "VulkanComputePipeline.h"
 #include "VulkanGraphicsPipeline.h"
 #include "VulkanImage.h"
 #include "VulkanUploadManager.h"
 
+#include <span>
+
 namespace RenderLib
 {
 
 namespace Vulkan
 {
 
+// Staging offsets are aligned to the largest texel block size.
+constexpr u64 STAGING_ALIGNMENT = 16;
+
 enum class CommandListUsage
 {
     GRAPHICS,
@@ -34,6 +40,15 @@ struct GraphicsState
     DescriptorSetHandle descriptorSet{nullptr};
 
     BufferHandle indirectBuffer;
+    // Draw count read by DrawIndirectCount.
+    BufferHandle indirectCountBuffer;
+};
+
+struct ComputeState
+{
+    ComputePipelineHandle pipeline{nullptr};
+
+    DescriptorSetHandle descriptorSet{nullptr};
 };
 
 struct RenderPassState
@@ -69,11 +84,25 @@ public:
     void Begin();
     void End();
 
-    void CopyBuffer(Buffer* src, Buffer* dst, u32 size, u32 srcOffset = 0, u32 dstOffset = 0);
-    void CopyBufferToImage(Buffer* buffer, Image* image);
-
-    void WriteBuffer(Buffer* buffer, const void* data, u32 size, u32 dstOffset = 0);
-    void WriteImage(Image* image, const void* data);
+    void CopyBuffer(Buffer* src, Buffer* dst, u64 size, u64 srcOffset = 0, u64 dstOffset = 0);
+    void CopyBufferToImage(Buffer* buffer, Image* image, u64 bufferOffset = 0, u32 mipLevel = 0);
+
+    /*
+     * Write functions copy data into the device's staging ring right away and record the copies.
+     * They return false if the staging ring has no room, submit the pending uploads and retry.
+     */
+    bool WriteBuffer(Buffer* buffer, const void* data, u64 size, u64 dstOffset = 0);
+    // Fills size bytes with the repeated 4 byte value, the whole buffer by default.
+    void FillBuffer(Buffer* buffer, u32 value, u64 size = VK_WHOLE_SIZE, u64 dstOffset = 0);
+    // Writes the first mip level.
+    bool WriteImage(Image* image, const void* data);
+    /*
+     * Writes one entry per mip level, starting at the first. Without transitionLayout the image
+     * must already be in eTransferDstOptimal and is left there, so transitions of many images can
+     * be batched with TransitionImageLayouts.
+     */
+    bool WriteImageMips(Image* image, std::span<const ImageMipData> mips,
+                        bool transitionLayout = true);
 
     // Sets and begin graphics pipeline.
     void SetGraphicsState(const GraphicsState& graphicsState);
@@ -81,8 +110,23 @@ public:
     void Draw(const DrawArguments& args);
     void DrawIndexed(const DrawArguments& args);
     void DrawIndirect(u32 offset, u32 drawCount);
+    // Draws the count read from the state's indirectCountBuffer at countOffset, up to maxDrawCount.
+    void DrawIndirectCount(u32 offset, u32 countOffset, u32 maxDrawCount);
+
+    // Binds compute pipeline, must be set outside of a render pass.
+    void SetComputeState(const ComputeState& computeState);
+    void PushComputeConstants(const void* data, u32 size, u32 offset = 0);
+    void Dispatch(u32 groupCountX, u32 groupCountY = 1, u32 groupCountZ = 1);
+    // Reads a vk::DispatchIndirectCommand from buffer at offset.
+    void DispatchIndirect(Buffer* buffer, u64 offset = 0);
+
+    // Makes srcAccess writes of srcStage to the whole buffer visible to dstAccess of dstStage.
+    void BufferBarrier(Buffer* buffer, vk::PipelineStageFlags srcStage, vk::AccessFlags srcAccess,
+                       vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
 
     void TransitionImageLayout(Image* image, vk::ImageLayout newLayout);
+    // Transitions all images with a single pipeline barrier.
+    void TransitionImageLayouts(std::span<Image* const> images, vk::ImageLayout newLayout);
 
     // XXX: Maybe no need to expose these?
     void BeginRenderPass(RenderPassState rpState);
@@ -93,10 +137,14 @@ public:
         return m_CommandBuffer;
     }
 
+    // Staging allocations read by the recorded commands, handed to the upload manager on submit.
+    std::vector<u64> TakeStagingTickets();
+
     CommandListDesc desc;
 
 private:
     void InitCommandBuffer();
+    void ReleaseStaging();
 
 private:
     const VulkanContext& m_Context;
@@ -105,10 +153,11 @@ private:
     vk::CommandBuffer m_CommandBuffer{nullptr};
     vk::CommandPool m_CommandPool{nullptr};
 
-    UploadManager m_UploadManager;
+    std::vector<u64> m_StagingTickets;
 
     // Holds strong reference to graphics pipeline objects.
     GraphicsState m_CurrentGraphicsState{};
+    ComputeState m_CurrentComputeState{};
 };
 
 using CommandListHandle = RefCountPtr<CommandList>;
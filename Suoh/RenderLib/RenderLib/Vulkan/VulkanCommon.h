@@ -55,6 +55,9 @@ static constexpr bool ENABLE_VALIDATION_LAYERS = true;
 static constexpr bool ENABLE_VALIDATION_LAYERS = false;
 #endif
 
+// Frames the CPU records ahead of the GPU, resources the CPU writes every frame are per frame slot.
+static constexpr u32 MAX_FRAMES_IN_FLIGHT = 2;
+
 const std::vector<const char*> VALIDATION_LAYERS = {"VK_LAYER_KHRONOS_validation"};
 const std::vector<const char*> DEVICE_EXTENSIONS = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
@@ -0,0 +1,78 @@
+#include "VulkanComputePipeline.h"
+
+#include "VulkanDevice.h"
+
+namespace RenderLib
+{
+
+namespace Vulkan
+{
+
+ComputePipeline::~ComputePipeline()
+{
+    if (pipeline)
+    {
+        m_Context.device.destroyPipeline(pipeline);
+    }
+    if (pipelineLayout)
+    {
+        m_Context.device.destroyPipelineLayout(pipelineLayout);
+    }
+}
+
+ComputePipelineHandle VulkanDevice::CreateComputePipeline(const ComputePipelineDesc& desc)
+{
+    if (desc.computeShader == nullptr)
+    {
+        LOG_ERROR("CreateComputePipeline: no shader passed in!");
+        return nullptr;
+    }
+    if (desc.computeShader->desc.type != ShaderType::COMPUTE)
+    {
+        LOG_ERROR("CreateComputePipeline: ", desc.computeShader->desc.fileName,
+                  " is not a compute shader!");
+        return nullptr;
+    }
+
+    auto handle = ComputePipelineHandle::Create(new ComputePipeline(m_Context));
+
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+    if (desc.constSize > 0)
+    {
+        pushConstantRanges.push_back(vk::PushConstantRange()
+                                         .setStageFlags(vk::ShaderStageFlagBits::eCompute)
+                                         .setOffset(0)
+                                         .setSize(desc.constSize));
+    }
+
+    // Create pipeline layout.
+    const auto layoutInfo = vk::PipelineLayoutCreateInfo()
+                                .setSetLayoutCount(1)
+                                .setPSetLayouts(&desc.descriptorSetLayout)
+                                .setPushConstantRangeCount(pushConstantRanges.size())
+                                .setPPushConstantRanges(pushConstantRanges.data());
+
+    VK_CHECK_RETURN_NULL(
+        m_Context.device.createPipelineLayout(&layoutInfo, nullptr, &handle->pipelineLayout));
+
+    const auto shaderStage = vk::PipelineShaderStageCreateInfo()
+                                 .setStage(vk::ShaderStageFlagBits::eCompute)
+                                 .setModule(desc.computeShader->shaderModule)
+                                 .setPName("main");
+
+    const auto pipelineInfo = vk::ComputePipelineCreateInfo()
+                                  .setStage(shaderStage)
+                                  .setLayout(handle->pipelineLayout)
+                                  .setBasePipelineHandle(nullptr)
+                                  .setBasePipelineIndex(-1);
+
+    VK_CHECK_RETURN_NULL(m_Context.device.createComputePipelines(nullptr, 1, &pipelineInfo,
+                                                                 nullptr, &handle->pipeline));
+    handle->desc = desc;
+
+    return handle;
+}
+
+} // namespace Vulkan
+
+} // namespace RenderLib
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "VulkanCommon.h"
+
+#include "VulkanShader.h"
+
+namespace RenderLib
+{
+
+namespace Vulkan
+{
+
+struct ComputePipelineDesc
+{
+    // Push constant range.
+    u32 constSize{0};
+
+    // XXX: replace with descriptor layout wrapper
+    vk::DescriptorSetLayout descriptorSetLayout;
+
+    ShaderHandle computeShader;
+};
+
+class ComputePipeline : public RefCountResource<IResource>
+{
+public:
+    explicit ComputePipeline(const VulkanContext& context) : m_Context(context)
+    {
+    }
+    ~ComputePipeline();
+
+    ComputePipelineDesc desc;
+
+    vk::PipelineLayout pipelineLayout;
+    vk::Pipeline pipeline;
+
+private:
+    const VulkanContext& m_Context;
+};
+
+using ComputePipelineHandle = RefCountPtr<ComputePipeline>;
+
+} // namespace Vulkan
+
+} // namespace RenderLib
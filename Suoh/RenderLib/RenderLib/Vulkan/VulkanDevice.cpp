@@ -3,6 +3,7 @@
 #include "VulkanUtils.h"
 
 #include <filesystem>
+#include <limits>
 
 namespace fs = std::filesystem;
 
@@ -22,16 +23,23 @@ VulkanDevice::VulkanDevice(const DeviceDesc& desc) : m_Instance(desc)
     m_PresentFamily = deviceContext.presentFamily;
     m_ComputeQueue = deviceContext.computeQueue;
     m_ComputeFamily = deviceContext.computeFamily;
+    m_TransferQueue = deviceContext.transferQueue;
+    m_TransferFamily = deviceContext.transferFamily;
 
     m_Context.device = deviceContext.device;
     m_Context.physicalDevice = deviceContext.physicalDevice;
     m_Context.instance = m_Instance.GetVkInstance();
     m_Context.surface = m_Instance.GetVkSurfaceKHR();
 
-    m_Swapchain.InitSwapchain(this, m_Context, desc.framebufferWidth, desc.framebufferHeight);
+    m_SupportsDrawIndirectCount = deviceContext.drawIndirectCount;
+    m_SupportsTextureCompressionBC = deviceContext.textureCompressionBC;
+
+    if (!IsHeadless())
+        m_Swapchain.InitSwapchain(this, m_Context, desc.framebufferWidth, desc.framebufferHeight);
 
     InitAllocator();
-    InitSwapchainImages();
+    if (!IsHeadless())
+        InitSwapchainImages();
     InitSynchronizationObjects();
 
     glslang_initialize_process();
@@ -43,12 +51,16 @@ VulkanDevice::~VulkanDevice()
 
     glslang_finalize_process();
 
-    m_Context.device.destroySemaphore(m_GraphicsSubmissionSemaphore);
-    m_Context.device.destroySemaphore(m_RenderSemaphore);
+    m_UploadManager.Destroy();
+
+    m_Context.device.destroySemaphore(m_GraphicsTimeline.semaphore);
+    m_Context.device.destroySemaphore(m_ComputeTimeline.semaphore);
+    m_Context.device.destroySemaphore(m_TransferTimeline.semaphore);
 
     vmaDestroyAllocator(m_Context.allocator);
 
-    m_Swapchain.Destroy();
+    if (!IsHeadless())
+        m_Swapchain.Destroy();
     m_Context.device.destroy();
 }
 
@@ -56,6 +68,11 @@ void* VulkanDevice::MapBuffer(Buffer* buffer)
 {
     void* ptr;
     vmaMapMemory(m_Context.allocator, buffer->allocation, &ptr);
+
+    // Read back memory may be cached and not coherent, make device writes visible to the host.
+    if (buffer->desc.cpuAccess == CpuAccessMode::READ)
+        vmaInvalidateAllocation(m_Context.allocator, buffer->allocation, 0, VK_WHOLE_SIZE);
+
     return ptr;
 }
 
@@ -135,99 +152,276 @@ void VulkanDevice::InitSynchronizationObjects()
     const auto semaphoreInfo = vk::SemaphoreCreateInfo().setPNext(&timelineInfo);
 
     auto res
-        = m_Context.device.createSemaphore(&semaphoreInfo, nullptr, &m_GraphicsSubmissionSemaphore);
+        = m_Context.device.createSemaphore(&semaphoreInfo, nullptr, &m_GraphicsTimeline.semaphore);
     if (res != vk::Result::eSuccess)
     {
         LOG_ERROR("Failed to create graphics queue timeline semaphore!");
     }
 
-    // Create render semaphore.
-    const auto renderSemaphoreInfo = vk::SemaphoreCreateInfo();
-    res = m_Context.device.createSemaphore(&renderSemaphoreInfo, nullptr, &m_RenderSemaphore);
+    res = m_Context.device.createSemaphore(&semaphoreInfo, nullptr, &m_ComputeTimeline.semaphore);
+    if (res != vk::Result::eSuccess)
+    {
+        LOG_ERROR("Failed to create compute queue timeline semaphore!");
+    }
+
+    res = m_Context.device.createSemaphore(&semaphoreInfo, nullptr, &m_TransferTimeline.semaphore);
     if (res != vk::Result::eSuccess)
     {
-        LOG_ERROR("Failed to create binary render semaphore!");
+        LOG_ERROR("Failed to create transfer queue timeline semaphore!");
     }
 }
 
-void VulkanDevice::Submit(CommandList* commandList)
+u64 VulkanDevice::Submit(CommandList* commandList)
 {
-    WaitGraphicsSubmissionSemaphore();
+    if (commandList->desc.queueType == QueueType::COMPUTE)
+    {
+        return SubmitAsync(commandList, m_ComputeQueue, m_ComputeTimeline, m_ComputeWaitGraphicsID,
+                           vk::PipelineStageFlagBits::eComputeShader);
+    }
 
-    m_LastSubmittedGraphicsID++;
+    if (commandList->desc.queueType == QueueType::TRANSFER)
+    {
+        // Uploads never depend on rendering.
+        u64 waitGraphicsID = 0;
+        return SubmitAsync(commandList, m_TransferQueue, m_TransferTimeline, waitGraphicsID,
+                           vk::PipelineStageFlagBits::eTransfer);
+    }
 
+    const u64 submissionID = ++m_GraphicsTimeline.lastSubmittedID;
+
+    // Binary semaphore values are ignored, but every semaphore needs one.
     std::vector<vk::Semaphore> waitSemaphores;
     std::vector<vk::PipelineStageFlags> waitStages;
+    std::vector<u64> waitValues;
 
-    std::vector<vk::Semaphore> signalSemaphores{m_GraphicsSubmissionSemaphore};
-    std::vector<u64> signalSemaphoreValues{m_LastSubmittedGraphicsID};
+    std::vector<vk::Semaphore> signalSemaphores{m_GraphicsTimeline.semaphore};
+    std::vector<u64> signalSemaphoreValues{submissionID};
 
-    if (commandList->desc.usage == CommandListUsage::GRAPHICS)
+    // Headless devices never acquire, so there is no swapchain to synchronize with.
+    const bool rendersSwapchainImage
+        = commandList->desc.usage == CommandListUsage::GRAPHICS && m_WaitForSwapchainImage;
+    if (rendersSwapchainImage)
     {
-        // Wait for swapchain acquire next image.
-        waitSemaphores.push_back(m_Swapchain.GetCurrentPresentSemaphore());
-
+        // The image is written as color attachment once the presentation engine released it.
+        waitSemaphores.push_back(m_Swapchain.GetCurrentAcquireSemaphore());
         waitStages.push_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        waitValues.push_back(0);
 
-        // Set ignal swapchain present semaphore.
-        signalSemaphores.push_back(m_RenderSemaphore);
-
-        // Add binary render semaphore value count(although ignored).
+        // Present waits for the rendering.
+        signalSemaphores.push_back(m_Swapchain.GetCurrentRenderSemaphore());
         signalSemaphoreValues.push_back(0);
     }
 
-    auto timelineInfo
-        = vk::TimelineSemaphoreSubmitInfo().setSignalSemaphoreValues(signalSemaphoreValues);
+    // Timeline waits on other queues.
+    if (m_GraphicsWaitComputeID != 0)
+    {
+        waitSemaphores.push_back(m_ComputeTimeline.semaphore);
+        waitStages.push_back(m_GraphicsWaitComputeStage);
+        waitValues.push_back(m_GraphicsWaitComputeID);
+
+        m_GraphicsWaitComputeID = 0;
+        m_GraphicsWaitComputeStage = {};
+    }
+    if (m_GraphicsWaitTransferID != 0)
+    {
+        waitSemaphores.push_back(m_TransferTimeline.semaphore);
+        waitStages.push_back(m_GraphicsWaitTransferStage);
+        waitValues.push_back(m_GraphicsWaitTransferID);
+
+        m_GraphicsWaitTransferID = 0;
+        m_GraphicsWaitTransferStage = {};
+    }
+
+    auto timelineInfo = vk::TimelineSemaphoreSubmitInfo()
+                            .setWaitSemaphoreValues(waitValues)
+                            .setSignalSemaphoreValues(signalSemaphoreValues);
 
     const auto submitInfo = vk::SubmitInfo()
-                                //.setWaitSemaphores(m_Swapchain.GetCurrentPresentSemaphore())
-                                //.setWaitDstStageMask(waitStages)
+                                .setWaitSemaphores(waitSemaphores)
+                                .setWaitDstStageMask(waitStages)
                                 .setCommandBuffers(commandList->GetCommandBuffer())
                                 .setSignalSemaphores(signalSemaphores)
                                 .setPNext(&timelineInfo);
 
-    VK_CHECK_RETURN(m_GraphicsQueue.submit(1, &submitInfo, nullptr));
+    const auto res = m_GraphicsQueue.submit(1, &submitInfo, nullptr);
+    if (res != vk::Result::eSuccess)
+    {
+        LOG_ERROR("Failed to submit to graphics queue! ", res);
+        m_UploadManager.Submit(commandList->TakeStagingTickets(), QueueType::GRAPHICS, 0);
+        return 0;
+    }
+
+    m_UploadManager.Submit(commandList->TakeStagingTickets(), QueueType::GRAPHICS, submissionID);
+
+    if (rendersSwapchainImage)
+    {
+        m_WaitForSwapchainImage = false;
+        m_SwapchainImageRendered = true;
+    }
+
+    return submissionID;
 }
 
-void VulkanDevice::WaitGraphicsSubmissionSemaphore()
+u64 VulkanDevice::SubmitAsync(CommandList* commandList, vk::Queue queue, QueueTimeline& timeline,
+                              u64& waitGraphicsID, vk::PipelineStageFlags waitStage)
 {
-    const auto waitInfo = vk::SemaphoreWaitInfo()
-                              .setSemaphores(m_GraphicsSubmissionSemaphore)
-                              .setValues(m_LastSubmittedGraphicsID);
-    VK_CHECK_RETURN(m_Context.device.waitSemaphores(&waitInfo, 1000000000));
+    const u64 submissionID = ++timeline.lastSubmittedID;
+
+    std::vector<vk::Semaphore> waitSemaphores;
+    std::vector<vk::PipelineStageFlags> waitStages;
+    std::vector<u64> waitValues;
+    if (waitGraphicsID != 0)
+    {
+        waitSemaphores.push_back(m_GraphicsTimeline.semaphore);
+        waitStages.push_back(waitStage);
+        waitValues.push_back(waitGraphicsID);
+
+        waitGraphicsID = 0;
+    }
 
-    m_LastFinishedGraphicsID
-        = m_Context.device.getSemaphoreCounterValue(m_GraphicsSubmissionSemaphore);
+    auto timelineInfo = vk::TimelineSemaphoreSubmitInfo()
+                            .setWaitSemaphoreValues(waitValues)
+                            .setSignalSemaphoreValues(submissionID);
 
-    assert(m_LastFinishedGraphicsID == m_LastSubmittedGraphicsID);
+    const auto submitInfo = vk::SubmitInfo()
+                                .setWaitSemaphores(waitSemaphores)
+                                .setWaitDstStageMask(waitStages)
+                                .setCommandBuffers(commandList->GetCommandBuffer())
+                                .setSignalSemaphores(timeline.semaphore)
+                                .setPNext(&timelineInfo);
+
+    const auto queueType = commandList->desc.queueType;
+
+    const auto res = queue.submit(1, &submitInfo, nullptr);
+    if (res != vk::Result::eSuccess)
+    {
+        LOG_ERROR("Failed to submit to ", queueType == QueueType::COMPUTE ? "compute" : "transfer",
+                  " queue! ", res);
+        m_UploadManager.Submit(commandList->TakeStagingTickets(), queueType, 0);
+        return 0;
+    }
+
+    m_UploadManager.Submit(commandList->TakeStagingTickets(), queueType, submissionID);
+
+    return submissionID;
+}
+
+void VulkanDevice::GraphicsWaitForCompute(u64 computeSubmissionID,
+                                          vk::PipelineStageFlags waitStage)
+{
+    assert(computeSubmissionID <= m_ComputeTimeline.lastSubmittedID);
+
+    // Later submissions signal higher values, waiting on the highest covers all of them.
+    m_GraphicsWaitComputeID = std::max(m_GraphicsWaitComputeID, computeSubmissionID);
+    m_GraphicsWaitComputeStage |= waitStage;
+}
+
+void VulkanDevice::GraphicsWaitForTransfer(u64 transferSubmissionID,
+                                           vk::PipelineStageFlags waitStage)
+{
+    assert(transferSubmissionID <= m_TransferTimeline.lastSubmittedID);
+
+    m_GraphicsWaitTransferID = std::max(m_GraphicsWaitTransferID, transferSubmissionID);
+    m_GraphicsWaitTransferStage |= waitStage;
 }
 
-void VulkanDevice::WaitTransferSubmissionSemaphore()
+void VulkanDevice::ComputeWaitForGraphics(u64 graphicsSubmissionID)
 {
+    assert(graphicsSubmissionID <= m_GraphicsTimeline.lastSubmittedID);
+
+    m_ComputeWaitGraphicsID = std::max(m_ComputeWaitGraphicsID, graphicsSubmissionID);
+}
+
+VulkanDevice::QueueTimeline& VulkanDevice::GetTimeline(QueueType queueType)
+{
+    switch (queueType)
+    {
+    case QueueType::COMPUTE:
+        return m_ComputeTimeline;
+    case QueueType::TRANSFER:
+        return m_TransferTimeline;
+    default:
+        return m_GraphicsTimeline;
+    }
+}
+
+bool VulkanDevice::WaitForSubmission(QueueType queueType, u64 submissionID)
+{
+    auto& timeline = GetTimeline(queueType);
+
+    if (submissionID == u64(-1))
+        submissionID = timeline.lastSubmittedID;
+
+    if (submissionID <= timeline.lastFinishedID)
+        return true;
+
+    // No timeout, callers reuse the memory and command lists of the submission once this returns.
     const auto waitInfo = vk::SemaphoreWaitInfo()
-                              .setSemaphores(m_TransferSubmissionSemaphore)
-                              .setValues(m_LastSubmittedTransferID);
-    VK_CHECK_RETURN(m_Context.device.waitSemaphores(&waitInfo, 1000000000));
+                              .setSemaphores(timeline.semaphore)
+                              .setValues(submissionID);
+    const auto result =
+        m_Context.device.waitSemaphores(&waitInfo, std::numeric_limits<u64>::max());
+    if (result != vk::Result::eSuccess)
+    {
+        LOG_ERROR("WaitForSubmission: Detected Vulkan error: ", result);
+        return false;
+    }
 
-    m_LastFinishedTransferID
-        = m_Context.device.getSemaphoreCounterValue(m_TransferSubmissionSemaphore);
+    timeline.lastFinishedID = m_Context.device.getSemaphoreCounterValue(timeline.semaphore);
+    return submissionID <= timeline.lastFinishedID;
+}
+
+bool VulkanDevice::IsSubmissionFinished(QueueType queueType, u64 submissionID)
+{
+    auto& timeline = GetTimeline(queueType);
 
-    assert(m_LastFinishedTransferID == m_LastSubmittedTransferID);
+    if (submissionID > timeline.lastFinishedID)
+        timeline.lastFinishedID = m_Context.device.getSemaphoreCounterValue(timeline.semaphore);
+
+    return submissionID <= timeline.lastFinishedID;
 }
 
-void VulkanDevice::Present()
+void VulkanDevice::WaitGraphicsSubmissionSemaphore()
 {
-    m_Swapchain.Present(m_RenderSemaphore);
+    WaitForSubmission(QueueType::GRAPHICS);
+
+    assert(m_GraphicsTimeline.lastFinishedID == m_GraphicsTimeline.lastSubmittedID);
 }
 
-void VulkanDevice::WaitIdle()
+void VulkanDevice::BeginFrame()
 {
-    m_Context.device.waitIdle();
+    // Resources of this frame slot are free once its last frame finished.
+    const auto& submissions = m_FrameSubmissions[m_FrameIndex];
+    WaitForSubmission(QueueType::GRAPHICS, submissions.graphicsID);
+    WaitForSubmission(QueueType::COMPUTE, submissions.computeID);
+
+    if (!IsHeadless())
+    {
+        m_Swapchain.AcquireNextImage(m_FrameIndex);
+        m_WaitForSwapchainImage = true;
+    }
 }
 
-void VulkanDevice::SwapchainAcquireNextImage()
+void VulkanDevice::EndFrame()
 {
-    m_Swapchain.AcquireNextImage();
+    // The semaphores are only wired up by a submission rendering to the image.
+    assert(!m_WaitForSwapchainImage);
+    if (m_SwapchainImageRendered)
+    {
+        m_Swapchain.Present();
+        m_SwapchainImageRendered = false;
+    }
+
+    m_FrameSubmissions[m_FrameIndex] = {
+        .graphicsID = m_GraphicsTimeline.lastSubmittedID,
+        .computeID = m_ComputeTimeline.lastSubmittedID,
+    };
+    m_FrameIndex = (m_FrameIndex + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+void VulkanDevice::WaitIdle()
+{
+    m_Context.device.waitIdle();
 }
 
 } // namespace Vulkan
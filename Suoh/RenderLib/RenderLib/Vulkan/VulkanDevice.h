@@ -6,9 +6,13 @@
 #include "VulkanBindings.h"
 #include "VulkanBuffer.h"
 #include "VulkanCommandList.h"
+#include "VulkanComputePipeline.h"
 #include "VulkanGraphicsPipeline.h"
 #include "VulkanImage.h"
 #include "VulkanShader.h"
+#include "VulkanUploadManager.h"
+
+#include <array>
 
 namespace RenderLib
 {
@@ -35,22 +39,79 @@ public:
     RenderPassHandle CreateRenderPass(const RenderPassDesc& desc);
     FramebufferHandle CreateFramebuffer(const FramebufferDesc& desc);
     GraphicsPipelineHandle CreateGraphicsPipeline(const GraphicsPipelineDesc& desc);
+    ComputePipelineHandle CreateComputePipeline(const ComputePipelineDesc& desc);
 
     DescriptorLayoutHandle CreateDescriptorLayout(const DescriptorLayoutDesc& desc);
     DescriptorSetHandle CreateDescriptorSet(const DescriptorSetDesc& desc);
 
     CommandListHandle CreateCommandList(const CommandListDesc& desc);
 
-    // XXX: Return submission ID?
-    void Submit(CommandList* commandList);
+    /*
+     * Submits to the queue of the command list's queueType and returns the submission ID on that
+     * queue's timeline. Submissions do not wait on the host, wait for a command list's submission
+     * before re-recording it, or use one per frame slot. The first graphics usage submission after
+     * BeginFrame waits for the swapchain image and signals it can be presented.
+     * Staging memory written by the command list is released once the submission finished.
+     */
+    u64 Submit(CommandList* commandList);
     void WaitGraphicsSubmissionSemaphore();
-    void WaitTransferSubmissionSemaphore();
+    /*
+     * Waits on the host for submissionID on queueType, by default the last submission, without a
+     * timeout. Returns false if the wait failed, e.g. on device loss.
+     */
+    bool WaitForSubmission(QueueType queueType, u64 submissionID = u64(-1));
+    bool IsSubmissionFinished(QueueType queueType, u64 submissionID);
+
+    /*
+     * Makes the next graphics submission wait on the GPU for a compute submission, before its
+     * waitStage. Compute results are consumed without stalling the CPU.
+     */
+    void GraphicsWaitForCompute(u64 computeSubmissionID, vk::PipelineStageFlags waitStage);
+    // Makes the next compute submission wait on the GPU for a graphics submission.
+    void ComputeWaitForGraphics(u64 graphicsSubmissionID);
+    // Makes the next graphics submission wait on the GPU for uploads on the transfer queue.
+    void GraphicsWaitForTransfer(u64 transferSubmissionID, vk::PipelineStageFlags waitStage);
+
+    // Staging ring all command lists write buffers and images through.
+    UploadManager& GetUploadManager()
+    {
+        return m_UploadManager;
+    }
+
+    /*
+     * BeginFrame waits on the host for the submissions of the frame that last used the frame slot,
+     * MAX_FRAMES_IN_FLIGHT frames ago, then acquires the next swapchain image. EndFrame presents
+     * it and moves to the next slot, so the CPU records a frame while the GPU renders the previous.
+     */
+    void BeginFrame();
+    void EndFrame();
+
+    // Frame slot in [0, MAX_FRAMES_IN_FLIGHT), index resources the CPU writes every frame with it.
+    u32 GetFrameIndex() const
+    {
+        return m_FrameIndex;
+    }
+
+    // Created without a window, there is no swapchain to acquire from or present to.
+    bool IsHeadless() const
+    {
+        return !m_Context.surface;
+    }
+
+    bool SupportsDrawIndirectCount() const
+    {
+        return m_SupportsDrawIndirectCount;
+    }
 
-    // XXX: expose synchronization primitives?
-    void Present();
+    // BC1-BC7 images can be sampled, otherwise they have to be decompressed on the CPU.
+    bool SupportsTextureCompressionBC() const
+    {
+        return m_SupportsTextureCompressionBC;
+    }
 
     void WaitIdle();
 
+    // CpuAccessMode::READ buffers are invalidated, reads see the writes of finished submissions.
     void* MapBuffer(Buffer* buffer);
     void UnmapBuffer(Buffer* buffer);
 
@@ -67,7 +128,6 @@ public:
     {
         return m_Swapchain.GetImageCount();
     }
-    void SwapchainAcquireNextImage();
 
     // Misc.
     vk::Format FindSupportedFormat(const std::vector<vk::Format>& formats, vk::ImageTiling tiling,
@@ -86,6 +146,10 @@ public:
     {
         return m_ComputeFamily;
     }
+    u32 GetTransferFamily() const
+    {
+        return m_TransferFamily;
+    }
     vk::Queue GetPresentQueue() const
     {
         return m_PresentQueue;
@@ -94,10 +158,42 @@ public:
     {
         return m_GraphicsQueue;
     }
+    vk::Queue GetComputeQueue() const
+    {
+        return m_ComputeQueue;
+    }
+    vk::Queue GetTransferQueue() const
+    {
+        return m_TransferQueue;
+    }
+    // Compute runs on its own queue family, resources used by both are shared concurrently.
+    bool HasAsyncCompute() const
+    {
+        return m_ComputeFamily != m_GraphicsFamily;
+    }
+    // Uploads can run on dedicated copy engines, in parallel with graphics work.
+    bool HasTransferQueue() const
+    {
+        return m_TransferFamily != m_GraphicsFamily;
+    }
 
 private:
+    // Timeline semaphore of a queue, signaled with the submission IDs.
+    struct QueueTimeline
+    {
+        vk::Semaphore semaphore;
+        u64 lastSubmittedID{0};
+        u64 lastFinishedID{0};
+    };
+
     void InitAllocator();
 
+    QueueTimeline& GetTimeline(QueueType queueType);
+
+    // Submits to the compute or transfer queue, waiting on the GPU for a graphics submission.
+    u64 SubmitAsync(CommandList* commandList, vk::Queue queue, QueueTimeline& timeline,
+                    u64& waitGraphicsID, vk::PipelineStageFlags waitStage);
+
     void InitSwapchainImages();
 
     void InitSynchronizationObjects();
@@ -113,30 +209,51 @@ private:
     vk::Queue m_GraphicsQueue;
     vk::Queue m_PresentQueue;
     vk::Queue m_ComputeQueue;
+    vk::Queue m_TransferQueue;
 
     u32 m_GraphicsFamily;
     u32 m_PresentFamily;
     u32 m_ComputeFamily;
+    u32 m_TransferFamily;
 
     // Context to inject to other classes/types when creating resources.
     VulkanContext m_Context;
 
+    bool m_SupportsDrawIndirectCount{false};
+    bool m_SupportsTextureCompressionBC{false};
+
     // Native swapchain resources transformed into new wrappers.
     std::vector<ImageHandle> m_SwapchainImages;
 
-    // Render semaphore, wait for this on present, signal on graphics submission.
-    vk::Semaphore m_RenderSemaphore;
+    // Last submissions of the frames that used each frame slot.
+    struct FrameSubmissions
+    {
+        u64 graphicsID{0};
+        u64 computeID{0};
+    };
+
+    u32 m_FrameIndex{0};
+    std::array<FrameSubmissions, MAX_FRAMES_IN_FLIGHT> m_FrameSubmissions{};
+    // Set by BeginFrame until a submission waits for the acquired image.
+    bool m_WaitForSwapchainImage{false};
+    // Set once a submission rendered to the acquired image, EndFrame presents it.
+    bool m_SwapchainImageRendered{false};
 
     // Queue submission synchronization.
     // XXX: Have a dedicated VulkanQueue class to handle this?
-    vk::Semaphore m_GraphicsSubmissionSemaphore;
-    u64 m_LastSubmittedGraphicsID{0};
-    u64 m_LastFinishedGraphicsID{0};
-
-    // Not used, since we do not have a transfer queue...
-    vk::Semaphore m_TransferSubmissionSemaphore;
-    u64 m_LastSubmittedTransferID{0};
-    u64 m_LastFinishedTransferID{0};
+    QueueTimeline m_GraphicsTimeline;
+    QueueTimeline m_ComputeTimeline;
+    QueueTimeline m_TransferTimeline;
+
+    // Cross queue waits consumed by the next submission of the waiting queue, 0 if none.
+    u64 m_GraphicsWaitComputeID{0};
+    vk::PipelineStageFlags m_GraphicsWaitComputeStage;
+    u64 m_GraphicsWaitTransferID{0};
+    vk::PipelineStageFlags m_GraphicsWaitTransferStage;
+    u64 m_ComputeWaitGraphicsID{0};
+
+    // Destroyed explicitly with the device, before the allocator.
+    UploadManager m_UploadManager{this};
 };
 
 } // namespace Vulkan
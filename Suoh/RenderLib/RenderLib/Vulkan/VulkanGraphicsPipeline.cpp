@@ -95,6 +95,17 @@ RenderPassHandle VulkanDevice::CreateRenderPass(const RenderPassDesc& desc)
 
         };
 
+    // Frames in flight share the depth image, wait for the previous frame's depth writes.
+    if (desc.hasDepth)
+    {
+        auto& dependency = subpassDependencies[0];
+        dependency.srcStageMask |= vk::PipelineStageFlagBits::eLateFragmentTests;
+        dependency.dstStageMask |= vk::PipelineStageFlagBits::eEarlyFragmentTests;
+        dependency.srcAccessMask |= vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        dependency.dstAccessMask |= vk::AccessFlagBits::eDepthStencilAttachmentRead
+                                    | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+    }
+
     if (offscreen)
     {
         colorAttachment.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
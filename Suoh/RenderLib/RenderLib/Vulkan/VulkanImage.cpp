@@ -1,6 +1,7 @@
 #include "VulkanImage.h"
 
 #include "VulkanDevice.h"
+#include "VulkanUtils.h"
 
 namespace RenderLib
 {
@@ -19,6 +20,11 @@ Image::~Image()
     }
 }
 
+u64 Image::GetMipSize(u32 mipLevel) const
+{
+    return GetImageMipSize(desc.format, desc.width, desc.height, mipLevel) * desc.layerCount;
+}
+
 void Image::CreateSubresourceView()
 {
     if (imageView)
@@ -76,7 +82,7 @@ ImageHandle VulkanDevice::CreateImage(const ImageDesc& desc)
               .setImageType(vk::ImageType::e2D)
               .setFormat(desc.format)
               .setExtent(vk::Extent3D().setWidth(desc.width).setHeight(desc.height).setDepth(1))
-              .setMipLevels(1)
+              .setMipLevels(desc.mipLevels)
               .setArrayLayers((desc.flags & vk::ImageCreateFlagBits::eCubeCompatible) ? 6 : 1)
               .setSamples(vk::SampleCountFlagBits::e1)
               .setTiling(desc.tiling)
@@ -121,7 +127,7 @@ SamplerHandle VulkanDevice::CreateSampler(const SamplerDesc& desc)
                                .setCompareEnable(false)
                                .setCompareOp(vk::CompareOp::eAlways)
                                .setMinLod(0.0f)
-                               .setMaxLod(0.0f)
+                               .setMaxLod(desc.maxLod)
                                .setBorderColor(vk::BorderColor::eIntOpaqueBlack)
                                .setUnnormalizedCoordinates(false);
 
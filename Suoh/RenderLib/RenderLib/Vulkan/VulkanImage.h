@@ -39,6 +39,9 @@ public:
     // Create imageview after layout transitions.
     void CreateSubresourceView();
 
+    // Tightly packed size of every layer of a mip level.
+    u64 GetMipSize(u32 mipLevel) const;
+
     ImageDesc desc;
 
     vk::Image image{nullptr};
@@ -57,11 +60,21 @@ private:
 
 using ImageHandle = RefCountPtr<Image>;
 
+// Tightly packed data of every layer of one mip level.
+struct ImageMipData
+{
+    const void* data;
+    u64 size;
+};
+
 struct SamplerDesc
 {
     vk::Filter minFilter{vk::Filter::eLinear};
     vk::Filter magFilter{vk::Filter::eLinear};
     vk::SamplerAddressMode addressMode{vk::SamplerAddressMode::eRepeat};
+
+    // Samples every mip level of the image by default.
+    float maxLod{VK_LOD_CLAMP_NONE};
 };
 
 // XXX: is this even needed?
@@ -46,12 +46,16 @@ bool CheckLayerSupport()
     return true;
 }
 
-std::vector<const char*> GetRequiredExtensions()
+std::vector<const char*> GetRequiredExtensions(bool headless)
 {
-    u32 glfwExtensionCount = 0;
-    auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    std::vector<const char*> extensions;
 
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    if (!headless)
+    {
+        u32 glfwExtensionCount = 0;
+        auto glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
     if (ENABLE_VALIDATION_LAYERS)
     {
@@ -116,6 +120,12 @@ VulkanDeviceContext VulkanInstance::CreateDevice(const DeviceDesc& desc)
     // auto features = physDevice.getFeatures();
 
     // XXX: Check properties and features specified in description are supported by physical device.
+    const auto supportedFeatures = physDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                                           vk::PhysicalDeviceVulkan12Features>();
+    result.drawIndirectCount
+        = supportedFeatures.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount;
+    result.textureCompressionBC
+        = supportedFeatures.get<vk::PhysicalDeviceFeatures2>().features.textureCompressionBC;
 
     /*
      * Create Logical Device.
@@ -123,8 +133,12 @@ VulkanDeviceContext VulkanInstance::CreateDevice(const DeviceDesc& desc)
     auto indices = FindQueueFamilies(physDevice, desc);
 
     std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-    const std::unordered_set<u32> uniqueQueueFamilies
-        = {indices.graphicsFamily, indices.computeFamily, indices.presentFamily};
+    const std::unordered_set<u32> uniqueQueueFamilies = {
+        indices.graphicsFamily,
+        indices.computeFamily,
+        indices.presentFamily,
+        indices.transferFamily,
+    };
     const float queuePriority = 1.0f;
     for (const auto queueFamily : uniqueQueueFamilies)
     {
@@ -140,6 +154,7 @@ VulkanDeviceContext VulkanInstance::CreateDevice(const DeviceDesc& desc)
                               .setMultiDrawIndirect(true)
                               .setPipelineStatisticsQuery(true)
                               .setTessellationShader(true)
+                              .setTextureCompressionBC(result.textureCompressionBC)
                               .setShaderSampledImageArrayDynamicIndexing(true);
 
     // Enable vulkan 1.1 features.
@@ -152,11 +167,15 @@ VulkanDeviceContext VulkanInstance::CreateDevice(const DeviceDesc& desc)
                                 .setDescriptorBindingPartiallyBound(true)
                                 .setDescriptorBindingVariableDescriptorCount(true)
                                 .setTimelineSemaphore(true)
+                                .setDrawIndirectCount(result.drawIndirectCount)
                                 .setShaderSampledImageArrayNonUniformIndexing(true)
                                 .setPNext(&vulkan11Features);
 
     // XXX: Add device extensions specified in description?
-    auto deviceExtensions = DEVICE_EXTENSIONS;
+    // Headless devices have nothing to present to.
+    std::vector<const char*> deviceExtensions;
+    if (m_Surface)
+        deviceExtensions = DEVICE_EXTENSIONS;
 
     // XXX: Add device layers specified in description?
     std::vector<const char*> deviceLayers;
@@ -185,7 +204,7 @@ VulkanDeviceContext VulkanInstance::CreateDevice(const DeviceDesc& desc)
     device.getQueue(indices.graphicsFamily, 0, &result.graphicsQueue);
     device.getQueue(indices.presentFamily, 0, &result.presentQueue);
     device.getQueue(indices.computeFamily, 0, &result.computeQueue);
-    // device.getQueue(indices.transferFamily, 0, &result.transferQueue);
+    device.getQueue(indices.transferFamily, 0, &result.transferQueue);
 
     result.graphicsFamily = indices.graphicsFamily;
     result.presentFamily = indices.presentFamily;
@@ -218,7 +237,7 @@ void VulkanInstance::InitInstance()
     {
         layers.insert(std::end(layers), std::begin(VALIDATION_LAYERS), std::end(VALIDATION_LAYERS));
     }
-    auto extensions = GetRequiredExtensions();
+    auto extensions = GetRequiredExtensions(m_glfwWindowPtr == nullptr);
 
     vk::ApplicationInfo appInfo = vk::ApplicationInfo().setApiVersion(VK_API_VERSION_1_3);
     vk::InstanceCreateInfo instanceInfo = vk::InstanceCreateInfo()
@@ -249,6 +268,12 @@ void VulkanInstance::InitInstance()
     /*
      * Surface creation.
      */
+    if (m_glfwWindowPtr == nullptr)
+    {
+        LOG_INFO("VulkanInstance: No window, creating headless instance.");
+        return;
+    }
+
     if (glfwCreateWindowSurface(m_Instance, (GLFWwindow*)m_glfwWindowPtr, nullptr,
                                 (VkSurfaceKHR*)&m_Surface)
         != VK_SUCCESS)
@@ -260,7 +285,8 @@ void VulkanInstance::InitInstance()
 
 void VulkanInstance::DestroyInstance()
 {
-    m_Instance.destroySurfaceKHR(m_Surface);
+    if (m_Surface)
+        m_Instance.destroySurfaceKHR(m_Surface);
     m_Instance.destroyDebugUtilsMessengerEXT(m_DebugMessenger);
     m_Instance.destroy();
 }
@@ -295,7 +321,33 @@ VulkanInstance::QueueFamilyIndices VulkanInstance::FindQueueFamilies(vk::Physica
     indices.graphicsFamily = u32(-1);
     indices.computeFamily = u32(-1);
     indices.presentFamily = u32(-1);
-    indices.presentFamily = u32(-1);
+    indices.transferFamily = u32(-1);
+
+    // Prefer a compute only family, so compute work runs asynchronously to graphics.
+    for (int i = 0; i < properties.size(); i++)
+    {
+        const auto& props = properties[i];
+
+        if ((props.queueFlags & vk::QueueFlagBits::eCompute)
+            && !(props.queueFlags & vk::QueueFlagBits::eGraphics))
+        {
+            indices.computeFamily = i;
+            break;
+        }
+    }
+
+    // Same for uploads, with a family only backed by the copy engines.
+    for (int i = 0; i < properties.size(); i++)
+    {
+        const auto& props = properties[i];
+
+        if ((props.queueFlags & vk::QueueFlagBits::eTransfer)
+            && !(props.queueFlags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)))
+        {
+            indices.transferFamily = i;
+            break;
+        }
+    }
 
     for (int i = 0; i < properties.size(); i++)
     {
@@ -321,18 +373,23 @@ VulkanInstance::QueueFamilyIndices VulkanInstance::FindQueueFamilies(vk::Physica
 
         if (indices.presentFamily == u32(-1))
         {
-            if (device.getSurfaceSupportKHR(i, m_Surface))
+            // Headless devices never present, keep the graphics queue as the present queue.
+            if (!m_Surface)
+            {
+                indices.presentFamily = indices.graphicsFamily;
+            }
+            else if (device.getSurfaceSupportKHR(i, m_Surface))
             {
                 indices.presentFamily = i;
             }
         }
 
+        // Graphics queues support transfers, even if they do not report it.
         if (indices.transferFamily == u32(-1))
         {
-            if (props.queueFlags & vk::QueueFlagBits::eTransfer)
+            if (props.queueFlags & vk::QueueFlagBits::eGraphics)
             {
                 indices.transferFamily = i;
-                LOG_INFO("Transfer family set!\n");
             }
         }
 
@@ -352,7 +409,8 @@ bool VulkanInstance::CheckDeviceExtensionSupport(vk::PhysicalDevice device,
     std::unordered_set<std::string> requiredExtensions(desc.deviceExtensions.begin(),
                                                        desc.deviceExtensions.end());
 
-    requiredExtensions.insert(std::begin(DEVICE_EXTENSIONS), std::end(DEVICE_EXTENSIONS));
+    if (m_Surface)
+        requiredExtensions.insert(std::begin(DEVICE_EXTENSIONS), std::end(DEVICE_EXTENSIONS));
 
     for (const auto& extension : extensions)
     {
@@ -20,6 +20,10 @@ struct VulkanDeviceContext
     vk::Queue transferQueue;
     i32 transferFamily{-1};
 
+    // Optional features enabled when the physical device supports them.
+    bool drawIndirectCount{false};
+    bool textureCompressionBC{false};
+
     vk::PhysicalDevice physicalDevice;
     vk::Device device;
 };
@@ -72,6 +76,7 @@ private:
     vk::DebugUtilsMessengerEXT m_DebugMessenger;
 
     vk::SurfaceKHR m_Surface;
+    // Null when headless.
     void* m_glfwWindowPtr;
 
     u32 m_PhysicalDeviceCount{0};
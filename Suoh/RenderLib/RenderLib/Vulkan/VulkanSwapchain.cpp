@@ -25,7 +25,11 @@ VulkanSwapchain::~VulkanSwapchain()
 
 void VulkanSwapchain::Destroy()
 {
-    for (auto semaphore : m_PresentSemaphores)
+    for (auto semaphore : m_AcquireSemaphores)
+    {
+        m_Context.device.destroySemaphore(semaphore);
+    }
+    for (auto semaphore : m_RenderSemaphores)
     {
         m_Context.device.destroySemaphore(semaphore);
     }
@@ -39,27 +43,27 @@ void VulkanSwapchain::Destroy()
     m_pDevice = nullptr;
 }
 
-void VulkanSwapchain::AcquireNextImage()
+void VulkanSwapchain::AcquireNextImage(u32 frameIndex)
 {
+    m_FrameIndex = frameIndex;
+
     const vk::Result res = m_Context.device.acquireNextImageKHR(m_Swapchain, ACQUIRE_TIMEOUT,
-                                                                m_PresentSemaphores[m_FrameIndex],
+                                                                m_AcquireSemaphores[m_FrameIndex],
                                                                 vk::Fence(), &m_ImageIndex);
     assert(res == vk::Result::eSuccess);
 }
 
-void VulkanSwapchain::Present(vk::Semaphore renderSemaphore)
+void VulkanSwapchain::Present()
 {
     auto presentInfo = vk::PresentInfoKHR()
                            .setWaitSemaphoreCount(1)
-                           .setPWaitSemaphores(&renderSemaphore)
+                           .setPWaitSemaphores(&m_RenderSemaphores[m_ImageIndex])
                            .setSwapchainCount(1)
                            .setPSwapchains(&m_Swapchain)
                            .setPImageIndices(&m_ImageIndex);
 
     auto res = m_pDevice->GetPresentQueue().presentKHR(presentInfo);
     VK_ASSERT_OK(res);
-
-    m_FrameIndex = (m_FrameIndex + 1) % m_ImageCount;
 }
 
 vk::Image VulkanSwapchain::GetImage(std::size_t index) const
@@ -82,9 +86,14 @@ size_t VulkanSwapchain::GetCurrentImageIndex() const
     return m_ImageIndex;
 }
 
-const vk::Semaphore& VulkanSwapchain::GetCurrentPresentSemaphore() const
+const vk::Semaphore& VulkanSwapchain::GetCurrentAcquireSemaphore() const
 {
-    return m_PresentSemaphores[m_FrameIndex];
+    return m_AcquireSemaphores[m_FrameIndex];
+}
+
+const vk::Semaphore& VulkanSwapchain::GetCurrentRenderSemaphore() const
+{
+    return m_RenderSemaphores[m_ImageIndex];
 }
 
 vk::Format VulkanSwapchain::GetSwapchainImageFormat() const
@@ -245,12 +254,16 @@ void VulkanSwapchain::InitSemaphores()
 {
     const auto semaphoreInfo = vk::SemaphoreCreateInfo();
 
-    m_PresentSemaphores.resize(m_ImageCount);
+    m_AcquireSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    for (auto& semaphore : m_AcquireSemaphores)
+    {
+        VK_CHECK_ABORT(m_Context.device.createSemaphore(&semaphoreInfo, nullptr, &semaphore));
+    }
 
-    for (size_t i = 0; i < m_ImageCount; i++)
+    m_RenderSemaphores.resize(m_ImageCount);
+    for (auto& semaphore : m_RenderSemaphores)
     {
-        VK_CHECK_ABORT(
-            m_Context.device.createSemaphore(&semaphoreInfo, nullptr, &m_PresentSemaphores[i]));
+        VK_CHECK_ABORT(m_Context.device.createSemaphore(&semaphoreInfo, nullptr, &semaphore));
     }
 }
 
@@ -24,8 +24,10 @@ public:
     void InitSwapchain(VulkanDevice* device, const VulkanContext& context, u32 width, u32 height);
     void Destroy();
 
-    void AcquireNextImage();
-    void Present(vk::Semaphore renderSemaphore);
+    // Signals the acquire semaphore of frameIndex once the image can be rendered to.
+    void AcquireNextImage(u32 frameIndex);
+    // Presents once the render semaphore of the acquired image is signaled.
+    void Present();
 
     vk::Image GetImage(std::size_t index) const;
     const vk::ImageView& GetImageView(std::size_t index) const;
@@ -35,7 +37,8 @@ public:
     // Get Swapchain image index.
     size_t GetCurrentImageIndex() const;
 
-    const vk::Semaphore& GetCurrentPresentSemaphore() const;
+    const vk::Semaphore& GetCurrentAcquireSemaphore() const;
+    const vk::Semaphore& GetCurrentRenderSemaphore() const;
 
     vk::Format GetSwapchainImageFormat() const;
     vk::Extent2D GetExtent() const;
@@ -71,15 +74,19 @@ private:
     std::vector<vk::Image> m_Images;
     std::vector<vk::ImageView> m_ImageViews;
 
-    // Per frame synchronization objects. Need RenderSemaphore as well?
-    // RenderSemaphore is currently in VulkanDevice.
-    std::vector<vk::Semaphore> m_PresentSemaphores;
+    /*
+     * Acquire semaphores are per frame slot, the device waits for the frame that last used a slot
+     * before acquiring with it again. Render semaphores are per image, acquiring an image again
+     * means its previous present, which waited on the semaphore, is done.
+     */
+    std::vector<vk::Semaphore> m_AcquireSemaphores;
+    std::vector<vk::Semaphore> m_RenderSemaphores;
 
     size_t m_ImageCount{0};
     // Image index returned from AcqureNextImage.
     u32 m_ImageIndex{0};
 
-    // Own internal frame counter to choose sync objects from previous frame.
+    // Frame slot passed to AcquireNextImage.
     u32 m_FrameIndex{0};
 };
 
@@ -10,39 +10,117 @@ namespace Vulkan
 
 UploadManager::~UploadManager()
 {
-    if (m_CurrentChunk)
+    Destroy();
+}
+
+void UploadManager::Destroy()
+{
+    if (m_Buffer)
+    {
+        m_pDevice->UnmapBuffer(m_Buffer);
+        m_MappedMemory = nullptr;
+        m_Buffer = nullptr;
+    }
+}
+
+void UploadManager::CreateBuffer()
+{
+    BufferDesc desc{};
+    desc.size = m_Size;
+    desc.cpuAccess = CpuAccessMode::WRITE;
+
+    m_Buffer = m_pDevice->CreateBuffer(desc);
+    if (m_Buffer)
+        m_MappedMemory = (u8*)m_pDevice->MapBuffer(m_Buffer);
+}
+
+bool UploadManager::Allocate(u64 size, u64 alignment, StagingAllocation& outAllocation)
+{
+    std::lock_guard lock(m_Mutex);
+
+    if (!m_Buffer)
+    {
+        CreateBuffer();
+        if (!m_Buffer)
+            return false;
+    }
+
+    if (size > m_Size)
+    {
+        LOG_ERROR("UploadManager: ", size, " bytes do not fit the ", m_Size, " byte staging ring!");
+        return false;
+    }
+
+    // Wrap around when the allocation does not fit before the end of the ring.
+    u64 offset = (m_Head + alignment - 1) / alignment * alignment;
+    if (offset + size > m_Size)
+        offset = 0;
+
+    const u64 end = offset + size;
+    const u64 consumed = (offset >= m_Head) ? (end - m_Head) : (m_Size - m_Head + end);
+
+    while (RetireFront(false))
+    {
+    }
+
+    while (m_UsedSize + consumed > m_Size)
     {
-        if (m_CurrentChunk->mappedMemory)
+        if (!RetireFront(true))
         {
-            m_pDevice->UnmapBuffer(m_CurrentChunk->buffer);
-            m_CurrentChunk->mappedMemory = nullptr;
+            LOG_ERROR("UploadManager: Staging ring is full of unsubmitted or unfinished uploads!");
+            return false;
         }
     }
+
+    m_Head = end;
+    m_UsedSize += consumed;
+    m_Regions.push_back({.size = consumed});
+
+    outAllocation.buffer = m_Buffer;
+    outAllocation.mappedMemory = m_MappedMemory + offset;
+    outAllocation.offset = offset;
+    outAllocation.ticket = m_FirstTicket + m_Regions.size() - 1;
+
+    return true;
 }
 
-BufferChunkPtr UploadManager::GetChunk()
+void UploadManager::Submit(std::span<const u64> tickets, QueueType queueType, u64 submissionID)
 {
-    if (!m_CurrentChunk)
+    std::lock_guard lock(m_Mutex);
+
+    for (const auto ticket : tickets)
     {
-        // XXX: Hardcoded ~300 mb staging buffer.
-        m_CurrentChunk = CreateChunk(268435456);
-    }
+        // Unsubmitted regions are never retired, so the ticket is still in the ring.
+        assert(ticket >= m_FirstTicket && ticket < m_FirstTicket + m_Regions.size());
 
-    return m_CurrentChunk;
+        auto& region = m_Regions[ticket - m_FirstTicket];
+        region.submitted = true;
+        region.queueType = queueType;
+        region.submissionID = submissionID;
+    }
 }
 
-BufferChunkPtr UploadManager::CreateChunk(u64 size)
+bool UploadManager::RetireFront(bool wait)
 {
-    BufferDesc desc{};
-    desc.size = size;
-    desc.cpuAccess = CpuAccessMode::WRITE;
+    if (m_Regions.empty() || !m_Regions.front().submitted)
+        return false;
+
+    const auto& region = m_Regions.front();
+    if (region.submissionID != 0)
+    {
+        if (wait)
+            m_pDevice->WaitForSubmission(region.queueType, region.submissionID);
+
+        // Checked even after waiting, a failed wait must not free memory the GPU may still read.
+        if (!m_pDevice->IsSubmissionFinished(region.queueType, region.submissionID))
+            return false;
+    }
 
-    auto chunk = std::make_shared<BufferChunk>();
-    chunk->buffer = m_pDevice->CreateBuffer(desc);
-    chunk->size = desc.size;
-    chunk->mappedMemory = m_pDevice->MapBuffer(chunk->buffer);
+    m_UsedSize -= region.size;
+    m_Regions.pop_front();
+    m_FirstTicket++;
 
-    return chunk;
+    return true;
 }
 
 } // namespace Vulkan
@@ -4,7 +4,9 @@
 
 #include "VulkanBuffer.h"
 
-#include <list>
+#include <deque>
+#include <mutex>
+#include <span>
 
 namespace RenderLib
 {
@@ -12,37 +14,85 @@ namespace RenderLib
 namespace Vulkan
 {
 
-struct BufferChunk
+// XXX: Get this from the device instead of hardcoding ~256 mb.
+constexpr u64 UPLOAD_RING_SIZE = 268435456;
+
+struct StagingAllocation
 {
-    BufferHandle buffer;
+    Buffer* buffer{nullptr};
     void* mappedMemory{nullptr};
-    u64 size;
-};
+    u64 offset{0};
 
-using BufferChunkPtr = std::shared_ptr<BufferChunk>;
+    // Handed back to UploadManager::Submit once the copies reading it are submitted.
+    u64 ticket{0};
+};
 
 class VulkanDevice;
 
 /*
- * Basically one large staging buffer for now.
+ * Ring of persistently mapped staging memory shared by all command lists.
+ * Allocations are freed in order once the submission that reads them finished. When the ring is
+ * full, Allocate waits for the oldest submitted allocations, so allocations of command lists that
+ * are never submitted must be submitted with an ID of 0 to release them.
  */
 class UploadManager
 {
 public:
-    explicit UploadManager(VulkanDevice* pDevice) : m_pDevice(pDevice)
+    explicit UploadManager(VulkanDevice* pDevice, u64 size = UPLOAD_RING_SIZE)
+        : m_pDevice(pDevice), m_Size(size)
     {
     }
     ~UploadManager();
 
-    BufferChunkPtr GetChunk();
+    NON_COPYABLE(UploadManager);
+    NON_MOVEABLE(UploadManager);
+
+    // Returns false if size does not fit the ring, or the ring is full of unsubmitted allocations.
+    bool Allocate(u64 size, u64 alignment, StagingAllocation& outAllocation);
+
+    // Ties allocations to the submission on queueType reading them, 0 frees them right away.
+    void Submit(std::span<const u64> tickets, QueueType queueType, u64 submissionID);
+
+    u64 GetSize() const
+    {
+        return m_Size;
+    }
+
+    // Releases the staging buffer, call before the allocator is destroyed.
+    void Destroy();
 
 private:
-    BufferChunkPtr CreateChunk(u64 size);
+    struct Region
+    {
+        // Bytes taken from the ring, including alignment and wrap around padding.
+        u64 size{0};
+
+        bool submitted{false};
+        QueueType queueType{QueueType::GRAPHICS};
+        u64 submissionID{0};
+    };
+
+    void CreateBuffer();
+
+    // Frees the oldest region if it is finished, waiting for its submission if wait is set.
+    bool RetireFront(bool wait);
 
 private:
     VulkanDevice* m_pDevice;
 
-    BufferChunkPtr m_CurrentChunk;
+    BufferHandle m_Buffer;
+    u8* m_MappedMemory{nullptr};
+    u64 m_Size;
+
+    u64 m_Head{0};
+    u64 m_UsedSize{0};
+
+    // Regions in allocation order, m_Regions[i] has ticket m_FirstTicket + i.
+    std::deque<Region> m_Regions;
+    u64 m_FirstTicket{1};
+
+    // Command lists recorded on different threads share the ring.
+    std::mutex m_Mutex;
 };
 
 } // namespace Vulkan
@@ -10,16 +10,16 @@ vk::BufferUsageFlags ToVkBufferUsageFlags(BufferUsage usage)
 {
     vk::BufferUsageFlags ret(0);
 
-    if (usage == BufferUsage::STORAGE_BUFFER)
-        ret = vk::BufferUsageFlagBits::eStorageBuffer;
-    if (usage == BufferUsage::VERTEX_BUFFER)
-        ret = vk::BufferUsageFlagBits::eVertexBuffer;
-    if (usage == BufferUsage::INDEX_BUFFER)
-        ret = vk::BufferUsageFlagBits::eIndexBuffer;
-    if (usage == BufferUsage::UNIFORM_BUFFER)
-        ret = vk::BufferUsageFlagBits::eUniformBuffer;
-    if (usage == BufferUsage::INDIRECT_BUFFER)
-        ret = vk::BufferUsageFlagBits::eIndirectBuffer;
+    if ((usage & BufferUsage::STORAGE_BUFFER) != 0)
+        ret |= vk::BufferUsageFlagBits::eStorageBuffer;
+    if ((usage & BufferUsage::VERTEX_BUFFER) != 0)
+        ret |= vk::BufferUsageFlagBits::eVertexBuffer;
+    if ((usage & BufferUsage::INDEX_BUFFER) != 0)
+        ret |= vk::BufferUsageFlagBits::eIndexBuffer;
+    if ((usage & BufferUsage::UNIFORM_BUFFER) != 0)
+        ret |= vk::BufferUsageFlagBits::eUniformBuffer;
+    if ((usage & BufferUsage::INDIRECT_BUFFER) != 0)
+        ret |= vk::BufferUsageFlagBits::eIndirectBuffer;
 
     return ret;
 }
@@ -48,6 +48,35 @@ u32 BytesPerTexFormat(vk::Format format)
     return 0;
 }
 
+u32 BytesPerTexBlock(vk::Format format)
+{
+    switch (format)
+    {
+    case vk::Format::eBc1RgbUnormBlock:
+    case vk::Format::eBc1RgbaUnormBlock:
+    case vk::Format::eBc4UnormBlock:
+        return 8;
+    case vk::Format::eBc3UnormBlock:
+    case vk::Format::eBc5UnormBlock:
+    case vk::Format::eBc7UnormBlock:
+        return 16;
+    default:
+        break;
+    }
+    return 0;
+}
+
+u64 GetImageMipSize(vk::Format format, u32 width, u32 height, u32 mipLevel)
+{
+    const u64 mipWidth = std::max(width >> mipLevel, 1u);
+    const u64 mipHeight = std::max(height >> mipLevel, 1u);
+
+    if (const auto blockSize = BytesPerTexBlock(format))
+        return ((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * blockSize;
+
+    return mipWidth * mipHeight * BytesPerTexFormat(format);
+}
+
 bool HasStencilComponent(vk::Format format)
 {
     if ((format == vk::Format::eD32SfloatS8Uint) || (format == vk::Format::eD24UnormS8Uint))
@@ -15,6 +15,12 @@ vk::BufferUsageFlags ToVkBufferUsageFlags(BufferUsage usage);
 
 u32 BytesPerTexFormat(vk::Format format);
 
+// Byte size of one 4x4 block for block compressed formats, 0 otherwise.
+u32 BytesPerTexBlock(vk::Format format);
+
+// Tightly packed byte size of a single layer of one mip level.
+u64 GetImageMipSize(vk::Format format, u32 width, u32 height, u32 mipLevel);
+
 bool HasStencilComponent(vk::Format format);
 
 glslang_stage_t ToGlslangShaderStageFromFileName(const std::string& fileName);
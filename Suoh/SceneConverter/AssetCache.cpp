@@ -0,0 +1,112 @@
+#include "AssetCache.h"
+
+#include <CoreUtils.h>
+#include <Logger.h>
+#include <MappedFile.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+AssetCache::AssetCache(const std::string& directory)
+{
+    if (directory.empty())
+        return;
+
+    std::error_code error;
+    fs::create_directories(directory, error);
+    if (error)
+    {
+        LOG_WARN("AssetCache: failed to create ", directory, ", caching is disabled");
+        return;
+    }
+
+    m_Directory = directory;
+}
+
+std::string AssetCache::GetEntryPath(u64 key) const
+{
+    std::ostringstream oss;
+    oss << std::hex << key;
+    return (fs::path(m_Directory) / oss.str()).string();
+}
+
+bool AssetCache::Load(u64 key, std::vector<u8>& data) const
+{
+    if (!IsEnabled())
+        return false;
+
+    std::ifstream inFile(GetEntryPath(key), std::ios::in | std::ios::binary | std::ios::ate);
+    if (!inFile)
+        return false;
+
+    data.resize((size_t)inFile.tellg());
+    inFile.seekg(0);
+    inFile.read((char*)data.data(), data.size());
+
+    return inFile.good();
+}
+
+void AssetCache::Store(u64 key, std::span<const u8> data) const
+{
+    if (!IsEnabled())
+        return;
+
+    const auto entryPath = GetEntryPath(key);
+
+    // Write to a per thread temporary and rename it, so a concurrent reader or writer of the same
+    // key never sees a partial entry.
+    const auto threadHash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    const auto tmpPath = entryPath + "." + std::to_string(threadHash);
+
+    std::ofstream outFile(tmpPath, std::ios::out | std::ios::binary);
+    outFile.write((const char*)data.data(), data.size());
+    outFile.close();
+
+    std::error_code error;
+    if (outFile.good())
+        fs::rename(tmpPath, entryPath, error);
+
+    if (!outFile.good() || error)
+    {
+        LOG_WARN("AssetCache: failed to store ", entryPath);
+        fs::remove(tmpPath, error);
+    }
+}
+
+bool AssetCache::FetchFile(u64 key, const std::string& outputFile) const
+{
+    if (!IsEnabled())
+        return false;
+
+    std::error_code error;
+    fs::copy_file(GetEntryPath(key), outputFile, fs::copy_options::overwrite_existing, error);
+
+    return !error;
+}
+
+void AssetCache::StoreFile(u64 key, const std::string& file) const
+{
+    if (!IsEnabled())
+        return;
+
+    MappedFile mappedFile;
+    if (!mappedFile.Open(file))
+        return;
+
+    Store(key, {mappedFile.GetData(), mappedFile.GetSize()});
+}
+
+bool HashFile(const std::string& fileName, u64& hash)
+{
+    MappedFile mappedFile;
+    if (!mappedFile.Open(fileName))
+        return false;
+
+    hash = HashBytes(mappedFile.GetData(), mappedFile.GetSize(), hash);
+    return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <CoreTypes.h>
+
+#include <span>
+#include <string>
+#include <vector>
+
+/*
+ * Persistent content addressed cache for converted assets.
+ * Every entry is a file named after the hash of everything its conversion depends on (source
+ * content and conversion settings), so a changed input simply misses and stale entries are never
+ * read. Entries can be deleted at any time. Safe to use from several threads.
+ */
+class AssetCache
+{
+public:
+    // An empty directory disables the cache.
+    explicit AssetCache(const std::string& directory);
+
+    bool IsEnabled() const
+    {
+        return !m_Directory.empty();
+    }
+
+    bool Load(u64 key, std::vector<u8>& data) const;
+    void Store(u64 key, std::span<const u8> data) const;
+
+    // Copies a cached file to outputFile, returns false on a miss.
+    bool FetchFile(u64 key, const std::string& outputFile) const;
+    void StoreFile(u64 key, const std::string& file) const;
+
+private:
+    std::string GetEntryPath(u64 key) const;
+
+    std::string m_Directory;
+};
+
+// Combines the content of a file into hash, returns false if the file cannot be read.
+bool HashFile(const std::string& fileName, u64& hash);
@@ -0,0 +1,214 @@
+#include "SceneConfig.h"
+
+#include <Logger.h>
+
+#include <charconv>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+std::string Trim(const std::string& s)
+{
+    const auto first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return std::string();
+
+    const auto last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+// Strips a trailing comment, ignoring '#' inside quoted strings.
+std::string StripComment(const std::string& line)
+{
+    bool inString = false;
+    for (size_t i = 0; i < line.size(); i++)
+    {
+        if (line[i] == '"' && (i == 0 || line[i - 1] != '\\'))
+            inString = !inString;
+        else if (line[i] == '#' && !inString)
+            return line.substr(0, i);
+    }
+
+    return line;
+}
+
+bool ParseString(const std::string& value, std::string& out)
+{
+    if (value.size() < 2 || value.front() != '"' || value.back() != '"')
+        return false;
+
+    out.clear();
+    for (size_t i = 1; i + 1 < value.size(); i++)
+    {
+        if (value[i] == '\\' && i + 2 < value.size())
+            i++;
+        out.push_back(value[i]);
+    }
+
+    return true;
+}
+
+bool ParseBool(const std::string& value, bool& out)
+{
+    if (value != "true" && value != "false")
+        return false;
+
+    out = (value == "true");
+    return true;
+}
+
+bool ParseU32(const std::string& value, u32& out)
+{
+    const auto result = std::from_chars(value.data(), value.data() + value.size(), out);
+    return result.ec == std::errc() && result.ptr == value.data() + value.size();
+}
+
+bool ParseFloat(const std::string& value, float& out)
+{
+    char* end = nullptr;
+    out = std::strtof(value.c_str(), &end);
+    return !value.empty() && end == value.c_str() + value.size();
+}
+
+bool SetSceneValue(SceneConfig& config, const std::string& key, const std::string& value)
+{
+    if (key == "file_name")
+        return ParseString(value, config.fileName);
+    if (key == "output_mesh")
+        return ParseString(value, config.outputMesh);
+    if (key == "output_scene")
+        return ParseString(value, config.outputScene);
+    if (key == "output_materials")
+        return ParseString(value, config.outputMaterials);
+    if (key == "texture_output_dir")
+        return ParseString(value, config.textureOutputDirectory);
+    if (key == "cache_dir")
+        return ParseString(value, config.cacheDirectory);
+    if (key == "scale")
+        return ParseFloat(value, config.scale);
+    if (key == "calculate_lods")
+        return ParseBool(value, config.calculateLODs);
+    if (key == "merge_instances")
+        return ParseBool(value, config.mergeInstances);
+    if (key == "encode_meshes")
+        return ParseBool(value, config.encodeMeshes);
+    if (key == "texture_max_size")
+        return ParseU32(value, config.textureMaxSize) && config.textureMaxSize > 0;
+
+    return false;
+}
+
+} // namespace
+
+bool LoadSceneManifest(const std::string& fileName, std::vector<SceneConfig>& scenes)
+{
+    std::ifstream inFile(fileName);
+    if (!inFile)
+    {
+        LOG_ERROR("LoadSceneManifest: failed to open ", fs::absolute(fileName));
+        return false;
+    }
+
+    SceneConfig defaults;
+    bool inScene = false;
+
+    std::string line;
+    for (u32 lineNumber = 1; std::getline(inFile, line); lineNumber++)
+    {
+        line = Trim(StripComment(line));
+        if (line.empty())
+            continue;
+
+        if (line == "[[scene]]")
+        {
+            scenes.push_back(defaults);
+            inScene = true;
+            continue;
+        }
+
+        const auto separator = line.find('=');
+        if (separator == std::string::npos)
+        {
+            LOG_ERROR("LoadSceneManifest: ", fileName, ":", lineNumber, " expected key = value");
+            return false;
+        }
+
+        const auto key = Trim(line.substr(0, separator));
+        const auto value = Trim(line.substr(separator + 1));
+
+        auto& config = inScene ? scenes.back() : defaults;
+        if (!SetSceneValue(config, key, value))
+        {
+            LOG_ERROR("LoadSceneManifest: ", fileName, ":", lineNumber, " invalid value for ", key);
+            return false;
+        }
+    }
+
+    for (const auto& config : scenes)
+    {
+        if (config.fileName.empty() || config.outputMesh.empty() || config.outputScene.empty()
+            || config.outputMaterials.empty())
+        {
+            LOG_ERROR("LoadSceneManifest: every scene in ", fileName,
+                      " needs file_name, output_mesh, output_scene and output_materials");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ParseCommandLine(int argc, char** argv, ConverterOptions& options)
+{
+    std::string manifestFile;
+    std::string cacheDirectory;
+    bool overrideCache = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--jobs" && i + 1 < argc)
+        {
+            if (!ParseU32(argv[++i], options.jobCount))
+            {
+                LOG_ERROR("Invalid job count: ", argv[i]);
+                return false;
+            }
+        }
+        else if (arg == "--cache" && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+            overrideCache = true;
+        }
+        else if (!arg.starts_with("--") && manifestFile.empty())
+        {
+            manifestFile = arg;
+        }
+        else
+        {
+            LOG_ERROR("Usage: ", argv[0], " [manifest] [--jobs N] [--cache DIR]");
+            return false;
+        }
+    }
+
+    if (!manifestFile.empty())
+    {
+        options.scenes.clear();
+        if (!LoadSceneManifest(manifestFile, options.scenes))
+            return false;
+    }
+
+    if (overrideCache)
+    {
+        for (auto& config : options.scenes)
+            config.cacheDirectory = cacheDirectory;
+    }
+
+    return true;
+}
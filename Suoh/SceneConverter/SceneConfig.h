@@ -0,0 +1,68 @@
+#pragma once
+
+#include <CoreTypes.h>
+
+#include <string>
+#include <vector>
+
+struct SceneConfig
+{
+    std::string fileName;
+    std::string outputMesh;
+    std::string outputScene;
+    std::string outputMaterials;
+    std::string textureOutputDirectory{"bistro_textures/"};
+
+    float scale{1.0f};
+    bool calculateLODs{false};
+    bool mergeInstances{false};
+    bool encodeMeshes{false};
+
+    // Converted textures are downscaled to fit in textureMaxSize x textureMaxSize.
+    u32 textureMaxSize{512};
+
+    // Converted meshes and textures are reused from here across runs, empty disables caching.
+    std::string cacheDirectory;
+};
+
+struct ConverterOptions
+{
+    std::vector<SceneConfig> scenes;
+
+    // Number of scenes converted concurrently, 0 uses the hardware thread count.
+    u32 jobCount{0};
+};
+
+/*
+ * Loads scene jobs from a manifest written in a small subset of TOML:
+ *
+ *     # Keys before the first [[scene]] are defaults for every scene.
+ *     scale = 0.01
+ *     cache_dir = "../Resources/.cache"
+ *
+ *     [[scene]]
+ *     file_name = "../Resources/Bistro/Exterior/exterior.obj"
+ *     output_mesh = "../Resources/Bistro/exterior.meshes"
+ *     output_scene = "../Resources/Bistro/exterior.scene"
+ *     output_materials = "../Resources/Bistro/exterior.materials"
+ *     texture_output_dir = "bistro_textures/"
+ *     texture_max_size = 1024
+ *     calculate_lods = true
+ *
+ * Keys map to SceneConfig members:
+ *
+ *     file_name          fileName             scale              scale
+ *     output_mesh        outputMesh           calculate_lods     calculateLODs
+ *     output_scene       outputScene          merge_instances    mergeInstances
+ *     output_materials   outputMaterials      encode_meshes      encodeMeshes
+ *     texture_output_dir textureOutputDirectory
+ *     texture_max_size   textureMaxSize
+ *     cache_dir          cacheDirectory
+ *
+ * Values are strings in double quotes, numbers or true/false.
+ */
+bool LoadSceneManifest(const std::string& fileName, std::vector<SceneConfig>& scenes);
+
+// Usage: SceneConverter [manifest] [--jobs N] [--cache DIR]
+// Scenes from a manifest replace the ones already in options, --cache applies to every scene.
+bool ParseCommandLine(int argc, char** argv, ConverterOptions& options);
@@ -0,0 +1,209 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+
+constexpr u32 BLOCK_DIMENSION = 4;
+constexpr u32 BLOCK_TEXEL_COUNT = BLOCK_DIMENSION * BLOCK_DIMENSION;
+
+// Gathers a 4x4 RGBA block, edge texels are repeated for images smaller than a block.
+void FetchBlock(const u8* rgba, u32 width, u32 height, u32 blockX, u32 blockY,
+                u8 block[BLOCK_TEXEL_COUNT * 4])
+{
+    for (u32 y = 0; y < BLOCK_DIMENSION; y++)
+    {
+        const u32 srcY = std::min(blockY * BLOCK_DIMENSION + y, height - 1);
+        for (u32 x = 0; x < BLOCK_DIMENSION; x++)
+        {
+            const u32 srcX = std::min(blockX * BLOCK_DIMENSION + x, width - 1);
+            memcpy(&block[(y * BLOCK_DIMENSION + x) * 4], &rgba[(srcY * width + srcX) * 4], 4);
+        }
+    }
+}
+
+u16 ToRGB565(const u8* color)
+{
+    return u16(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+void FromRGB565(u16 packed, u8* color)
+{
+    const u8 r = (packed >> 11) & 0x1f;
+    const u8 g = (packed >> 5) & 0x3f;
+    const u8 b = packed & 0x1f;
+
+    color[0] = u8((r << 3) | (r >> 2));
+    color[1] = u8((g << 2) | (g >> 4));
+    color[2] = u8((b << 3) | (b >> 2));
+}
+
+void CompressColorBlock(const u8 block[BLOCK_TEXEL_COUNT * 4], u8* dst)
+{
+    u8 minColor[3] = {255, 255, 255};
+    u8 maxColor[3] = {0, 0, 0};
+
+    for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+    {
+        for (u32 c = 0; c < 3; c++)
+        {
+            minColor[c] = std::min(minColor[c], block[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], block[i * 4 + c]);
+        }
+    }
+
+    // Inset the bounding box so the endpoints are not pulled towards outliers.
+    for (u32 c = 0; c < 3; c++)
+    {
+        const u8 inset = (maxColor[c] - minColor[c]) >> 4;
+        minColor[c] = u8(minColor[c] + inset);
+        maxColor[c] = u8(maxColor[c] - inset);
+    }
+
+    u16 color0 = ToRGB565(maxColor);
+    u16 color1 = ToRGB565(minColor);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    u32 indices = 0;
+
+    // Equal endpoints leave every index at 0, otherwise color0 > color1 selects 4 color mode.
+    if (color0 != color1)
+    {
+        u8 palette[4][3];
+        FromRGB565(color0, palette[0]);
+        FromRGB565(color1, palette[1]);
+        for (u32 c = 0; c < 3; c++)
+        {
+            palette[2][c] = u8((2 * palette[0][c] + palette[1][c]) / 3);
+            palette[3][c] = u8((palette[0][c] + 2 * palette[1][c]) / 3);
+        }
+
+        for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        {
+            u32 bestIndex = 0;
+            i32 bestError = std::numeric_limits<i32>::max();
+            for (u32 p = 0; p < 4; p++)
+            {
+                i32 error = 0;
+                for (u32 c = 0; c < 3; c++)
+                {
+                    const i32 d = i32(block[i * 4 + c]) - i32(palette[p][c]);
+                    error += d * d;
+                }
+
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+
+            indices |= bestIndex << (i * 2);
+        }
+    }
+
+    memcpy(dst, &color0, sizeof(color0));
+    memcpy(dst + 2, &color1, sizeof(color1));
+    memcpy(dst + 4, &indices, sizeof(indices));
+}
+
+// Compresses one channel, the alpha of BC3 or either channel of BC5.
+void CompressChannelBlock(const u8 block[BLOCK_TEXEL_COUNT * 4], u32 channel, u8* dst)
+{
+    u8 value0 = 0;
+    u8 value1 = 255;
+    for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+    {
+        value0 = std::max(value0, block[i * 4 + channel]);
+        value1 = std::min(value1, block[i * 4 + channel]);
+    }
+
+    u64 indices = 0;
+
+    // value0 > value1 selects the 8 value mode, equal endpoints leave every index at 0.
+    if (value0 != value1)
+    {
+        u8 palette[8];
+        palette[0] = value0;
+        palette[1] = value1;
+        for (u32 p = 2; p < 8; p++)
+            palette[p] = u8(((8 - p) * value0 + (p - 1) * value1) / 7);
+
+        for (u32 i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        {
+            u64 bestIndex = 0;
+            i32 bestError = std::numeric_limits<i32>::max();
+            for (u32 p = 0; p < 8; p++)
+            {
+                const i32 error = std::abs(i32(block[i * 4 + channel]) - i32(palette[p]));
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = p;
+                }
+            }
+
+            indices |= bestIndex << (i * 3);
+        }
+    }
+
+    dst[0] = value0;
+    dst[1] = value1;
+    // 48 bits of indices, little endian.
+    memcpy(dst + 2, &indices, 6);
+}
+
+} // namespace
+
+u32 GetBlockCompressedSize(BlockCompressionFormat format, u32 width, u32 height)
+{
+    const u32 blockSize = (format == BlockCompressionFormat::BC1) ? 8 : 16;
+    const u32 blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    const u32 blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+
+    return blocksX * blocksY * blockSize;
+}
+
+std::vector<u8> CompressImage(BlockCompressionFormat format, const u8* rgba, u32 width,
+                              u32 height)
+{
+    std::vector<u8> compressed(GetBlockCompressedSize(format, width, height));
+
+    const u32 blocksX = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    const u32 blocksY = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+
+    u8* dst = compressed.data();
+    u8 block[BLOCK_TEXEL_COUNT * 4];
+
+    for (u32 blockY = 0; blockY < blocksY; blockY++)
+    {
+        for (u32 blockX = 0; blockX < blocksX; blockX++)
+        {
+            FetchBlock(rgba, width, height, blockX, blockY, block);
+
+            if (format == BlockCompressionFormat::BC5)
+            {
+                CompressChannelBlock(block, 0, dst);
+                CompressChannelBlock(block, 1, dst + 8);
+                dst += 16;
+                continue;
+            }
+
+            if (format == BlockCompressionFormat::BC3)
+            {
+                CompressChannelBlock(block, 3, dst);
+                dst += 8;
+            }
+
+            CompressColorBlock(block, dst);
+            dst += 8;
+        }
+    }
+
+    return compressed;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <CoreTypes.h>
+
+#include <vector>
+
+enum class BlockCompressionFormat
+{
+    // RGB, 8 bytes per 4x4 block.
+    BC1,
+    // RGB and interpolated alpha, 16 bytes per 4x4 block.
+    BC3,
+    // Red and green, each interpolated like BC3 alpha, 16 bytes per 4x4 block. Meant for normal
+    // maps, z is reconstructed when sampling.
+    BC5,
+};
+
+u32 GetBlockCompressedSize(BlockCompressionFormat format, u32 width, u32 height);
+
+/*
+ * Compresses a tightly packed RGBA8 image into 4x4 blocks stored row by row, the layout expected
+ * by KTX and Vulkan. Endpoints are fitted to the bounding box of every block (inset to reduce the
+ * error of the extremes), which is fast and good enough for offline conversion of scene textures.
+ */
+std::vector<u8> CompressImage(BlockCompressionFormat format, const u8* rgba, u32 width,
+                              u32 height);
@@ -1,9 +1,16 @@
 #include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <execution>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <span>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <assimp/Importer.hpp>
@@ -12,16 +19,19 @@
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
 
 #include <stb_image.h>
 #include <stb_image_resize.h>
-#include <stb_image_write.h>
+
+#include <gli/gli.hpp>
+#include <gli/save_ktx.hpp>
+#include <gli/texture2d.hpp>
 
 #include <meshoptimizer.h>
 
+#include <CoreUtils.h>
 #include <Logger.h>
 
 #include <RenderDescription/Material.h>
@@ -29,19 +39,15 @@
 #include <RenderDescription/Scene.h>
 #include <RenderDescription/Utils.h>
 
+#include "AssetCache.h"
+#include "SceneConfig.h"
+#include "TextureCompression.h"
+
 namespace fs = std::filesystem;
 
-struct SceneConfig
-{
-    std::string fileName;
-    std::string outputMesh;
-    std::string outputScene;
-    std::string outputMaterials;
-
-    float scale;
-    bool calculateLODs;
-    bool mergeInstances{false};
-};
+// Bump when the output of mesh or texture conversion changes, so stale cache entries are missed.
+static constexpr u32 MESH_CACHE_VERSION = 1;
+static constexpr u32 TEXTURE_CACHE_VERSION = 3;
 
 glm::mat4 ToMat4(const aiMatrix4x4& from)
 {
@@ -65,28 +71,26 @@ glm::mat4 ToMat4(const aiMatrix4x4& from)
     return to;
 }
 
-void Traverse(const aiScene* sourceScene, Scene& scene, aiNode* N, int parent, int ofs)
+// meshRemap maps source mesh indices to converted mesh indices.
+void Traverse(const aiScene* sourceScene, Scene& scene, aiNode* N, int parent, int ofs,
+              const std::vector<u32>& meshRemap)
 {
     int newNode = AddNode(scene, parent, ofs);
 
     if (N->mName.C_Str())
-    {
-        u32 stringID = (u32)scene.names.size();
-        scene.names.push_back(std::string(N->mName.C_Str()));
-        scene.namesMap[newNode] = stringID;
-    }
+        SetNodeName(scene, newNode, N->mName.C_Str());
 
     for (size_t i = 0; i < N->mNumMeshes; i++)
     {
         int newSubNode = AddNode(scene, newNode, ofs + 1);
 
-        u32 stringID = (u32)scene.names.size();
-        scene.names.push_back(std::string(N->mName.C_Str()) + "_Mesh_" + std::to_string(i));
-        scene.namesMap[newSubNode] = stringID;
+        SetNodeName(scene, newSubNode,
+                    std::string(N->mName.C_Str()) + "_Mesh_" + std::to_string(i));
 
+        // Merged instances share the converted mesh but keep their own material.
         int mesh = (int)N->mMeshes[i];
-        scene.meshesMap[newSubNode] = mesh;
-        scene.materialsMap[newSubNode] = sourceScene->mMeshes[mesh]->mMaterialIndex;
+        SetComponent(scene.meshIds, newSubNode, meshRemap[mesh]);
+        SetComponent(scene.materialIds, newSubNode, sourceScene->mMeshes[mesh]->mMaterialIndex);
 
         scene.globalTransforms[newSubNode] = glm::mat4(1.0f);
         scene.localTransforms[newSubNode] = glm::mat4(1.0f);
@@ -96,7 +100,7 @@ void Traverse(const aiScene* sourceScene, Scene& scene, aiNode* N, int parent, i
     scene.localTransforms[newNode] = ToMat4(N->mTransformation);
 
     for (unsigned int n = 0; n < N->mNumChildren; n++)
-        Traverse(sourceScene, scene, N->mChildren[n], newNode, ofs + 1);
+        Traverse(sourceScene, scene, N->mChildren[n], newNode, ofs + 1, meshRemap);
 }
 
 std::string ReplaceAll(const std::string& str, const std::string& oldSubStr,
@@ -141,20 +145,66 @@ std::string GetFileBaseName(const std::string& path)
     return path.substr(path.find_last_of("/\\") + 1);
 }
 
-std::string ConvertTexture(const std::string& file, const std::string& basePath,
+// Decides the block compression format and how the mip chain is filtered.
+enum class TextureMapType : u32
+{
+    // Albedo and emissive, alpha is kept if the texture uses it.
+    COLOR,
+    // Renormalized after every downsample, stored as BC5 x and y.
+    NORMAL,
+    // Metallic-roughness and ambient occlusion.
+    DATA,
+};
+
+void RenormalizeNormalMap(std::vector<u8>& rgba)
+{
+    for (size_t i = 0; i < rgba.size(); i += 4)
+    {
+        vec3 n(rgba[i] / 127.5f - 1.0f, rgba[i + 1] / 127.5f - 1.0f, rgba[i + 2] / 127.5f - 1.0f);
+
+        const float length = glm::length(n);
+        if (length > 0.0f)
+            n = n * (1.0f / length);
+
+        for (auto c = 0; c < 3; c++)
+            rgba[i + c] = (u8)std::clamp((n[c] + 1.0f) * 127.5f + 0.5f, 0.0f, 255.0f);
+    }
+}
+
+std::string ConvertTexture(const std::string& file, TextureMapType type, const SceneConfig& config,
+                           const std::string& basePath,
                            std::unordered_map<std::string, u32>& opacityMapIndices,
-                           const std::vector<std::string>& opacityMaps)
+                           const std::vector<std::string>& opacityMaps, const AssetCache& cache)
 {
-    const auto maxNewWidth = 512;
-    const auto maxNewHeight = 512;
+    const auto maxNewWidth = (int)config.textureMaxSize;
+    const auto maxNewHeight = (int)config.textureMaxSize;
 
     const auto srcFile = ReplaceAll(basePath + file, "\\", "/");
 
-    // XXX: Make this configurable from scene config.
-    const auto newFile = "bistro_textures/" +
-                         // GetFileBaseName(srcFile)
-                         LowercaseString(ReplaceAll(ReplaceAll(srcFile, "..", "_"), "/", "_"))
-                         + "_r.png";
+    const auto newFileName
+        = LowercaseString(ReplaceAll(ReplaceAll(srcFile, "..", "_"), "/", "_")) + "_r.ktx";
+    const auto newFile = (fs::path(config.textureOutputDirectory) / newFileName).generic_string();
+
+    const auto opacityMapFile
+        = (opacityMapIndices.count(file) > 0)
+              ? ReplaceAll(basePath + opacityMaps[opacityMapIndices[file]], "\\", "/")
+              : std::string();
+
+    // The key covers the source pixels, the opacity mask and every conversion setting.
+    u64 cacheKey = HashValue(TEXTURE_CACHE_VERSION);
+    cacheKey = HashValue(maxNewWidth, cacheKey);
+    cacheKey = HashValue(maxNewHeight, cacheKey);
+    cacheKey = HashValue(type, cacheKey);
+
+    const bool cacheable
+        = cache.IsEnabled() && HashFile(FixTextureFile(srcFile), cacheKey)
+          && (opacityMapFile.empty() || HashFile(FixTextureFile(opacityMapFile), cacheKey));
+
+    if (cacheable && cache.FetchFile(cacheKey, newFile))
+    {
+        LOG_INFO("Reusing cached texture ", srcFile);
+        return newFile;
+    }
 
     // Load the image.
     int texWidth, texHeight, texChannels;
@@ -179,10 +229,8 @@ std::string ConvertTexture(const std::string& file, const std::string& basePath,
                  texChannels, " channels");
     }
 
-    if (opacityMapIndices.count(file) > 0)
+    if (!opacityMapFile.empty())
     {
-        const auto opacityMapFile
-            = ReplaceAll(basePath + opacityMaps[opacityMapIndices[file]], "\\", "/");
         int opacityWidth, opacityHeight;
         stbi_uc* opacityPixels = stbi_load(FixTextureFile(opacityMapFile).c_str(), &opacityWidth,
                                            &opacityHeight, nullptr, 1);
@@ -206,26 +254,76 @@ std::string ConvertTexture(const std::string& file, const std::string& basePath,
         stbi_image_free(opacityPixels);
     }
 
-    const u32 imgSize = texWidth * texHeight * texChannels;
-    std::vector<u8> mipData(imgSize);
-    uint8_t* dst = mipData.data();
+    const u32 newW = std::min(texWidth, maxNewWidth);
+    const u32 newH = std::min(texHeight, maxNewHeight);
 
-    const int newW = std::min(texWidth, maxNewWidth);
-    const int newH = std::min(texHeight, maxNewHeight);
-
-    stbir_resize_uint8(src, texWidth, texHeight, 0, dst, newW, newH, 0, texChannels);
-
-    int write_res = stbi_write_png(newFile.c_str(), newW, newH, texChannels, dst, 0);
+    // Full mip chain down to 1x1, every level is downsampled from the previous one.
+    std::vector<std::vector<u8>> mips;
+    mips.emplace_back(newW * newH * texChannels);
+    stbir_resize_uint8(src, texWidth, texHeight, 0, mips.back().data(), newW, newH, 0, texChannels);
 
     if (pixels)
         stbi_image_free(pixels);
 
+    for (u32 w = newW, h = newH; w > 1 || h > 1;)
+    {
+        const u32 mipW = std::max(w / 2, 1u);
+        const u32 mipH = std::max(h / 2, 1u);
+
+        std::vector<u8> mip(mipW * mipH * texChannels);
+        stbir_resize_uint8(mips.back().data(), w, h, 0, mip.data(), mipW, mipH, 0, texChannels);
+
+        if (type == TextureMapType::NORMAL)
+            RenormalizeNormalMap(mip);
+
+        mips.push_back(std::move(mip));
+        w = mipW;
+        h = mipH;
+    }
+
+    bool hasAlpha = false;
+    if (type == TextureMapType::COLOR)
+    {
+        for (size_t i = 3; i < mips[0].size() && !hasAlpha; i += 4)
+            hasAlpha = mips[0][i] != 255;
+    }
+
+    // Normal maps keep x and y in BC5, which holds them with far less error than BC1 holds xyz.
+    auto format = hasAlpha ? BlockCompressionFormat::BC3 : BlockCompressionFormat::BC1;
+    auto gliFormat
+        = hasAlpha ? gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16 : gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+    if (type == TextureMapType::NORMAL)
+    {
+        format = BlockCompressionFormat::BC5;
+        gliFormat = gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+    }
+
+    gli::texture2d texture(gliFormat, gli::extent2d(newW, newH), mips.size());
+
+    for (u32 level = 0; level < mips.size(); level++)
+    {
+        const u32 mipW = std::max(newW >> level, 1u);
+        const u32 mipH = std::max(newH >> level, 1u);
+
+        const auto blocks = CompressImage(format, mips[level].data(), mipW, mipH);
+        assert(blocks.size() == texture.size(level));
+        memcpy(texture.data(0, 0, level), blocks.data(), blocks.size());
+    }
+
+    const bool write_res = gli::save_ktx(texture, newFile);
+    if (!write_res)
+        LOG_ERROR("Failed to write texture: ", newFile);
+
+    if (cacheable && write_res)
+        cache.StoreFile(cacheKey, newFile);
+
     return newFile;
 }
 
 void ConvertAndDownscaleAllTextures(const std::vector<MaterialDescription>& materials,
-                                    const std::string& basePath, std::vector<std::string>& files,
-                                    std::vector<std::string>& opacityMaps)
+                                    const SceneConfig& config, const std::string& basePath,
+                                    std::vector<std::string>& files,
+                                    std::vector<std::string>& opacityMaps, const AssetCache& cache)
 {
     std::unordered_map<std::string, u32> opacityMapIndices(files.size());
 
@@ -233,12 +331,24 @@ void ConvertAndDownscaleAllTextures(const std::vector<MaterialDescription>& mate
         if (m.opacityMap != INVALID_TEXTURE && m.albedoMap != INVALID_TEXTURE)
             opacityMapIndices[files[m.albedoMap]] = (u32)m.opacityMap;
 
-    auto converter = [&](const std::string& s) -> std::string {
-        return ConvertTexture(s, basePath, opacityMapIndices, opacityMaps);
+    // Maps that are not referenced as color or normal maps hold material parameters.
+    std::vector<TextureMapType> fileTypes(files.size(), TextureMapType::DATA);
+    for (const auto& m : materials)
+    {
+        if (m.albedoMap != INVALID_TEXTURE)
+            fileTypes[m.albedoMap] = TextureMapType::COLOR;
+        if (m.emissiveMap != INVALID_TEXTURE)
+            fileTypes[m.emissiveMap] = TextureMapType::COLOR;
+        if (m.normalMap != INVALID_TEXTURE)
+            fileTypes[m.normalMap] = TextureMapType::NORMAL;
+    }
+
+    auto converter = [&](const std::string& s, TextureMapType type) -> std::string {
+        return ConvertTexture(s, type, config, basePath, opacityMapIndices, opacityMaps, cache);
     };
 
-    std::transform(std::execution::par, std::begin(files), std::end(files), std::begin(files),
-                   converter);
+    std::transform(std::execution::par, std::begin(files), std::end(files), std::begin(fileTypes),
+                   std::begin(files), converter);
 }
 
 static constexpr auto NUM_VERTEX_ELEMENTS = 3 + 3 + 2;
@@ -432,20 +542,116 @@ void ProcessLods(std::vector<u32>& indices, std::vector<float>& vertices,
     }
 };
 
-Mesh ConvertAIMesh(const aiMesh* aimesh, const SceneConfig& config, MeshData& meshData,
-                   u32& indexOffset, u32& vertexOffset)
+u64 HashAIMesh(const aiMesh* aimesh, const SceneConfig& config)
+{
+    u64 hash = HashValue(MESH_CACHE_VERSION);
+    hash = HashValue(config.scale, hash);
+    hash = HashValue(config.calculateLODs, hash);
+
+    hash = HashBytes(aimesh->mVertices, sizeof(aiVector3D) * aimesh->mNumVertices, hash);
+    hash = HashValue(aimesh->HasNormals(), hash);
+    if (aimesh->HasNormals())
+        hash = HashBytes(aimesh->mNormals, sizeof(aiVector3D) * aimesh->mNumVertices, hash);
+
+    hash = HashValue(aimesh->HasTextureCoords(0), hash);
+    if (aimesh->HasTextureCoords(0))
+    {
+        hash = HashBytes(aimesh->mTextureCoords[0], sizeof(aiVector3D) * aimesh->mNumVertices,
+                         hash);
+    }
+
+    for (u32 i = 0; i != aimesh->mNumFaces; i++)
+    {
+        const auto& face = aimesh->mFaces[i];
+        hash = HashValue(face.mNumIndices, hash);
+        hash = HashBytes(face.mIndices, sizeof(u32) * face.mNumIndices, hash);
+    }
+
+    return hash;
+}
+
+/*
+ * Cached mesh layout: u32 LOD count, u32 index count of every LOD, the converted vertices and
+ * then the indices of every LOD.
+ */
+bool LoadCachedMesh(const AssetCache& cache, u64 key, std::span<float> vertices,
+                    std::vector<std::vector<u32>>& outLods)
+{
+    std::vector<u8> data;
+    if (!cache.Load(key, data))
+        return false;
+
+    auto readSize = sizeof(u32);
+    if (data.size() < readSize)
+        return false;
+
+    u32 lodCount = 0;
+    memcpy(&lodCount, data.data(), sizeof(u32));
+    if (lodCount == 0 || lodCount >= MAX_LODS)
+        return false;
+
+    std::vector<u32> lodSizes(lodCount);
+    readSize += sizeof(u32) * lodCount;
+    if (data.size() < readSize)
+        return false;
+    memcpy(lodSizes.data(), data.data() + sizeof(u32), sizeof(u32) * lodCount);
+
+    u64 indexCount = 0;
+    for (const auto size : lodSizes)
+        indexCount += size;
+
+    if (data.size() != readSize + vertices.size_bytes() + sizeof(u32) * indexCount)
+        return false;
+
+    const u8* src = data.data() + readSize;
+    memcpy(vertices.data(), src, vertices.size_bytes());
+    src += vertices.size_bytes();
+
+    outLods.resize(lodCount);
+    for (u32 l = 0; l < lodCount; l++)
+    {
+        outLods[l].resize(lodSizes[l]);
+        memcpy(outLods[l].data(), src, sizeof(u32) * lodSizes[l]);
+        src += sizeof(u32) * lodSizes[l];
+    }
+
+    return true;
+}
+
+void StoreCachedMesh(const AssetCache& cache, u64 key, std::span<const float> vertices,
+                     const std::vector<std::vector<u32>>& lods)
+{
+    std::vector<u32> header;
+    header.push_back((u32)lods.size());
+    for (const auto& lod : lods)
+        header.push_back((u32)lod.size());
+
+    std::vector<u8> data;
+    const auto append = [&data](const void* src, size_t size) {
+        data.insert(data.end(), (const u8*)src, (const u8*)src + size);
+    };
+
+    append(header.data(), sizeof(u32) * header.size());
+    append(vertices.data(), vertices.size_bytes());
+    for (const auto& lod : lods)
+        append(lod.data(), sizeof(u32) * lod.size());
+
+    cache.Store(key, data);
+}
+
+void ConvertAIMeshData(const aiMesh* aimesh, const SceneConfig& config, std::span<float> vertices,
+                       std::vector<std::vector<u32>>& outLods)
 {
     const bool hasTexCoords = aimesh->HasTextureCoords(0);
-    const u32 streamElementSize = static_cast<u32>(NUM_VERTEX_ELEMENTS * sizeof(float));
 
     // Original data for LOD calculation
     std::vector<float> srcVertices;
     std::vector<u32> srcIndices;
 
-    std::vector<std::vector<u32>> outLods;
-
-    auto& vertices = meshData.vertexData;
+    if (config.calculateLODs)
+        srcVertices.reserve(aimesh->mNumVertices * 3);
 
+    float* dst = vertices.data();
     for (auto i = 0; i != aimesh->mNumVertices; i++)
     {
         // vertices
@@ -464,27 +670,19 @@ Mesh ConvertAIMesh(const aiMesh* aimesh, const SceneConfig& config, MeshData& me
             srcVertices.push_back(v.z);
         }
 
-        vertices.push_back(v.x * config.scale);
-        vertices.push_back(v.y * config.scale);
-        vertices.push_back(v.z * config.scale);
+        *dst++ = v.x * config.scale;
+        *dst++ = v.y * config.scale;
+        *dst++ = v.z * config.scale;
 
-        vertices.push_back(t.x);
-        vertices.push_back(1.0f - t.y);
+        *dst++ = t.x;
+        *dst++ = 1.0f - t.y;
 
-        vertices.push_back(n.x);
-        vertices.push_back(n.y);
-        vertices.push_back(n.z);
+        *dst++ = n.x;
+        *dst++ = n.y;
+        *dst++ = n.z;
     }
 
-    Mesh result = {
-        .vertexCount = aimesh->mNumVertices,
-        .vertexOffset = vertexOffset,
-        .indexOffset = indexOffset,
-        .streamCount = 1,
-        .streamOffset = {vertexOffset * streamElementSize},
-        .streamElementSize = {streamElementSize},
-    };
-
+    srcIndices.reserve(aimesh->mNumFaces * 3);
     for (auto i = 0; i != aimesh->mNumFaces; i++)
     {
         if (aimesh->mFaces[i].mNumIndices != 3)
@@ -494,34 +692,213 @@ Mesh ConvertAIMesh(const aiMesh* aimesh, const SceneConfig& config, MeshData& me
     }
 
     if (!config.calculateLODs)
-        outLods.push_back(srcIndices);
+        outLods.push_back(std::move(srcIndices));
     else
         ProcessLods(srcIndices, srcVertices, outLods);
+}
+
+/*
+ * Converts a mesh into its preallocated vertex slice and collects its LOD index lists.
+ * Does not touch any shared state so meshes can be converted concurrently, the index offset and
+ * LOD offsets are filled in once every mesh's index count is known.
+ */
+Mesh ConvertAIMesh(const aiMesh* aimesh, const SceneConfig& config, const AssetCache& cache,
+                   u64 meshHash, std::span<float> vertices, u32 vertexOffset,
+                   std::vector<std::vector<u32>>& outLods)
+{
+    const u32 streamElementSize = static_cast<u32>(NUM_VERTEX_ELEMENTS * sizeof(float));
+
+    if (!LoadCachedMesh(cache, meshHash, vertices, outLods))
+    {
+        outLods.clear();
+        ConvertAIMeshData(aimesh, config, vertices, outLods);
+        if (cache.IsEnabled())
+            StoreCachedMesh(cache, meshHash, vertices, outLods);
+    }
+
+    Mesh result = {
+        .vertexCount = aimesh->mNumVertices,
+        .vertexOffset = vertexOffset,
+        .streamCount = 1,
+        .streamOffset = {vertexOffset * streamElementSize},
+        .streamElementSize = {streamElementSize},
+    };
 
     u32 numIndices = 0;
     for (auto l = 0; l < outLods.size(); l++)
     {
-        for (auto i = 0; i < outLods[l].size(); i++)
-            meshData.indexData.push_back(outLods[l][i]);
-
         result.lodOffset[l] = numIndices;
-        numIndices += (int)outLods[l].size();
+        numIndices += (u32)outLods[l].size();
     }
 
     result.lodOffset[outLods.size()] = numIndices;
     result.lodCount = (u32)outLods.size();
 
-    indexOffset += numIndices;
-    vertexOffset += aimesh->mNumVertices;
-
     return result;
 }
 
-void ProcessScene(const SceneConfig& config)
+bool AIMeshesEqual(const aiMesh* a, const aiMesh* b)
+{
+    if (a->mNumVertices != b->mNumVertices || a->mNumFaces != b->mNumFaces
+        || a->HasTextureCoords(0) != b->HasTextureCoords(0))
+    {
+        return false;
+    }
+
+    const auto streamSize = sizeof(aiVector3D) * a->mNumVertices;
+    if (memcmp(a->mVertices, b->mVertices, streamSize) != 0
+        || memcmp(a->mNormals, b->mNormals, streamSize) != 0
+        || (a->HasTextureCoords(0)
+            && memcmp(a->mTextureCoords[0], b->mTextureCoords[0], streamSize) != 0))
+    {
+        return false;
+    }
+
+    for (auto i = 0; i != a->mNumFaces; i++)
+    {
+        const auto& faceA = a->mFaces[i];
+        const auto& faceB = b->mFaces[i];
+        if (faceA.mNumIndices != faceB.mNumIndices
+            || memcmp(faceA.mIndices, faceB.mIndices, sizeof(u32) * faceA.mNumIndices) != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Converts every unique source mesh once. Source meshes with identical vertex and index streams
+ * are merged when config.mergeInstances is set, meshRemap maps every source mesh to the index of
+ * its converted mesh. Fails if the merged streams do not fit the 32 bit offsets of Mesh.
+ */
+bool ConvertAIMeshes(const aiScene* scene, const SceneConfig& config, const AssetCache& cache,
+                     MeshData& meshData, std::vector<u32>& meshRemap)
+{
+    const auto sourceMeshes = std::span<aiMesh* const>(scene->mMeshes, scene->mNumMeshes);
+
+    // Stream hashes serve both as cache keys and as the first test for merging.
+    std::vector<u64> meshHashes(sourceMeshes.size(), 0);
+    if (config.mergeInstances || cache.IsEnabled())
+    {
+        std::transform(std::execution::par, sourceMeshes.begin(), sourceMeshes.end(),
+                       meshHashes.begin(),
+                       [&config](const aiMesh* aimesh) { return HashAIMesh(aimesh, config); });
+    }
+
+    // Source indices of the meshes that are converted.
+    std::vector<u32> uniqueMeshes;
+    meshRemap.resize(sourceMeshes.size());
+
+    if (config.mergeInstances)
+    {
+        // Hash collisions are resolved by comparing the streams.
+        std::unordered_map<u64, std::vector<u32>> meshesByHash;
+        for (u32 i = 0; i != sourceMeshes.size(); i++)
+        {
+            auto& candidates = meshesByHash[meshHashes[i]];
+            const auto match
+                = std::find_if(candidates.begin(), candidates.end(), [&](u32 candidate) {
+                      return AIMeshesEqual(sourceMeshes[uniqueMeshes[candidate]], sourceMeshes[i]);
+                  });
+
+            if (match != candidates.end())
+            {
+                meshRemap[i] = *match;
+            }
+            else
+            {
+                meshRemap[i] = (u32)uniqueMeshes.size();
+                candidates.push_back(meshRemap[i]);
+                uniqueMeshes.push_back(i);
+            }
+        }
+
+        LOG_INFO("Merged ", sourceMeshes.size(), " meshes into ", uniqueMeshes.size(),
+                 " unique meshes");
+    }
+    else
+    {
+        uniqueMeshes.resize(sourceMeshes.size());
+        std::iota(uniqueMeshes.begin(), uniqueMeshes.end(), 0);
+        std::iota(meshRemap.begin(), meshRemap.end(), 0);
+    }
+
+    const auto meshCount = (u32)uniqueMeshes.size();
+
+    // Phase 1: prefix sum the vertex counts so every mesh writes into its own vertex slice, then
+    // convert and simplify all meshes concurrently.
+    std::vector<u32> vertexOffsets(meshCount + 1, 0);
+    u64 vertexCount = 0;
+    for (u32 i = 0; i != meshCount; i++)
+    {
+        vertexCount += sourceMeshes[uniqueMeshes[i]]->mNumVertices;
+
+        // Mesh::streamOffset is the largest offset, in bytes.
+        if (vertexCount * NUM_VERTEX_ELEMENTS * sizeof(float) > std::numeric_limits<u32>::max())
+        {
+            LOG_ERROR("ConvertAIMeshes: ", vertexCount, " vertices exceed the mesh file limit");
+            return false;
+        }
+
+        vertexOffsets[i + 1] = (u32)vertexCount;
+    }
+
+    meshData.vertexData.resize((size_t)vertexOffsets[meshCount] * NUM_VERTEX_ELEMENTS);
+    meshData.meshes.resize(meshCount);
+
+    std::vector<std::vector<std::vector<u32>>> meshLods(meshCount);
+    std::atomic<u32> convertedCount{0};
+
+    const std::span<float> vertices = meshData.vertexData;
+
+    std::for_each(std::execution::par, meshData.meshes.begin(), meshData.meshes.end(),
+                  [&](Mesh& mesh) {
+                      const auto i = (u32)(&mesh - meshData.meshes.data());
+                      const auto sourceIndex = uniqueMeshes[i];
+                      const aiMesh* aimesh = sourceMeshes[sourceIndex];
+
+                      mesh = ConvertAIMesh(
+                          aimesh, config, cache, meshHashes[sourceIndex],
+                          vertices.subspan(vertexOffsets[i] * NUM_VERTEX_ELEMENTS,
+                                           aimesh->mNumVertices * NUM_VERTEX_ELEMENTS),
+                          vertexOffsets[i], meshLods[i]);
+
+                      LOG_INFO("Converted meshes, ", ++convertedCount, "/", meshCount, "...");
+                  });
+
+    // Phase 2: prefix sum the index counts and copy every mesh's LODs into its index slice.
+    u64 indexOffset = 0;
+    for (auto& mesh : meshData.meshes)
+    {
+        mesh.indexOffset = (u32)indexOffset;
+        indexOffset += mesh.GetIndicesCount();
+    }
+
+    if (indexOffset > std::numeric_limits<u32>::max())
+    {
+        LOG_ERROR("ConvertAIMeshes: ", indexOffset, " indices exceed the mesh file limit");
+        return false;
+    }
+
+    meshData.indexData.resize(indexOffset);
+
+    std::for_each(std::execution::par, meshData.meshes.begin(), meshData.meshes.end(),
+                  [&](const Mesh& mesh) {
+                      const auto i = &mesh - meshData.meshes.data();
+
+                      auto dst = meshData.indexData.begin() + mesh.indexOffset;
+                      for (const auto& lod : meshLods[i])
+                          dst = std::copy(lod.begin(), lod.end(), dst);
+                  });
+
+    return true;
+}
+
+bool ProcessScene(const SceneConfig& config)
 {
     MeshData meshData;
-    u32 indexOffset = 0;
-    u32 vertexOffset = 0;
 
     const std::size_t pathSeparator = config.fileName.find_last_of("/\\");
     const std::string basePath = (pathSeparator != std::string::npos)
@@ -536,35 +913,34 @@ void ProcessScene(const SceneConfig& config)
 
     LOG_INFO("Importing model: ", config.fileName);
 
+    // Always imported, the cache only skips the per mesh and per texture work. Assimp may read
+    // files next to fileName (materials, buffers), so the source file alone is not a safe key.
     Assimp::Importer import;
     const aiScene* scene = import.ReadFile(config.fileName.c_str(), flags);
 
     if (!scene || !scene->HasMeshes())
     {
         LOG_ERROR("Unable to load: ", fs::absolute(config.fileName));
-        exit(EXIT_FAILURE);
+        return false;
     }
 
     // 1. Mesh conversion.
-    meshData.meshes.reserve(scene->mNumMeshes);
-    meshData.boundingBoxes.reserve(scene->mNumMeshes);
+    const AssetCache cache(config.cacheDirectory);
 
-    for (unsigned int i = 0; i != scene->mNumMeshes; i++)
-    {
-        LOG_INFO("Converting meshes,  ", i + 1, "/", scene->mNumMeshes, "...");
-        Mesh mesh = ConvertAIMesh(scene->mMeshes[i], config, meshData, indexOffset, vertexOffset);
-        meshData.meshes.push_back(mesh);
-    }
+    std::vector<u32> meshRemap;
+    if (!ConvertAIMeshes(scene, config, cache, meshData, meshRemap))
+        return false;
 
     RecalculateBoundingBoxes(meshData);
 
-    SaveMeshData(config.outputMesh.c_str(), meshData);
+    if (!SaveMeshData(config.outputMesh.c_str(), meshData, config.encodeMeshes))
+        return false;
 
     Scene ourScene;
 
     // 2. Material conversion.
     std::vector<MaterialDescription> materials;
-    std::vector<std::string>& materialNames = ourScene.materialNames;
+    StringTable& materialNames = ourScene.materialNames;
 
     std::vector<std::string> files;
     std::vector<std::string> opacityMaps;
@@ -574,55 +950,101 @@ void ProcessScene(const SceneConfig& config)
         aiMaterial* mm = scene->mMaterials[m];
 
         LOG_INFO("Material [", mm->GetName().C_Str(), "] ", m);
-        materialNames.push_back(std::string(mm->GetName().C_Str()));
+        materialNames.Add(mm->GetName().C_Str());
 
         MaterialDescription D = ConvertAIMaterialToMaterialDescription(mm, files, opacityMaps);
         materials.push_back(D);
     }
 
     // 3. Texture processing, rescaling and packing.
-    ConvertAndDownscaleAllTextures(materials, basePath, files, opacityMaps);
+    std::error_code error;
+    fs::create_directories(config.textureOutputDirectory, error);
+    if (error)
+    {
+        LOG_ERROR("Unable to create texture directory: ", config.textureOutputDirectory);
+        return false;
+    }
+
+    ConvertAndDownscaleAllTextures(materials, config, basePath, files, opacityMaps, cache);
 
-    SaveMaterials(config.outputMaterials, materials, files);
+    if (!SaveMaterials(config.outputMaterials, materials, files))
+        return false;
 
     // 4. Scene hierarchy conversion.
-    Traverse(scene, ourScene, scene->mRootNode, -1, 0);
+    Traverse(scene, ourScene, scene->mRootNode, -1, 0, meshRemap);
+
+    // Depth first traversal interleaves levels, save nodes in level order.
+    ReorderSceneByLevel(ourScene);
 
-    SaveScene(config.outputScene, ourScene);
+    return SaveScene(config.outputScene, ourScene);
 }
 
-int main()
+int main(int argc, char** argv)
 {
     LOG_SET_OUTPUT(&std::cout);
-    LOG_INFO("Running scene conversion...");
 
-    std::vector<SceneConfig> sceneConfigs{
+    ConverterOptions options;
+    options.scenes = {
         {
             .fileName = "../Resources/Bistro/Exterior/exterior.obj",
             .outputMesh = "../Resources/Bistro/exterior.meshes",
             .outputScene = "../Resources/Bistro/exterior.scene",
             .outputMaterials = "../Resources/Bistro/exterior.materials",
+            .textureOutputDirectory = "bistro_textures/",
             .scale = 0.01,
             .calculateLODs = false,
             .mergeInstances = false,
+            .encodeMeshes = false,
+            .cacheDirectory = "../Resources/Bistro/.cache",
         },
-        /* {
-             .fileName = "../../../../../Resources/bistro/Interior/interior.obj",
-             .outputMesh = "../../../../../Resources/bistro/interior.meshes",
-             .outputScene = "../../../../../Resources/bistro/interior.scene",
-             .outputMaterials = "../../../../../Resources/bistro/interior.materials",
-             .scale = 0.01,
-             .calculateLODs = false,
-             .mergeInstances = false,
-         },*/
     };
 
-    for (const auto& config : sceneConfigs)
+    if (!ParseCommandLine(argc, argv, options))
+        return EXIT_FAILURE;
+
+    const auto& scenes = options.scenes;
+    const u32 hardwareJobs = std::max(std::thread::hardware_concurrency(), 1u);
+    const u32 jobCount
+        = std::min(options.jobCount ? options.jobCount : hardwareJobs, (u32)scenes.size());
+
+    LOG_INFO("Running scene conversion of ", scenes.size(), " scenes with ", jobCount, " jobs...");
+
+    // Every scene already converts its meshes and textures in parallel, the pool only bounds how
+    // many scenes are in flight at once.
+    std::vector<u8> succeeded(scenes.size(), false);
+    std::vector<double> seconds(scenes.size(), 0.0);
+    std::atomic<u32> nextScene{0};
+
+    const auto worker = [&]() {
+        for (u32 i = nextScene++; i < scenes.size(); i = nextScene++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const bool result = ProcessScene(scenes[i]);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+            succeeded[i] = result;
+            seconds[i] = elapsed.count();
+
+            LOG_INFO("Scene ", scenes[i].fileName, (result ? " converted" : " FAILED"), " in ",
+                     elapsed.count(), "s");
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (u32 i = 0; i < jobCount; i++)
+        workers.emplace_back(worker);
+    for (auto& thread : workers)
+        thread.join();
+
+    u32 failedCount = 0;
+    for (u32 i = 0; i < scenes.size(); i++)
     {
-        ProcessScene(config);
+        LOG_INFO("  ", (succeeded[i] ? "ok    " : "failed"), " ", seconds[i], "s  ",
+                 scenes[i].fileName);
+        failedCount += succeeded[i] ? 0 : 1;
     }
 
-    LOG_INFO("Conversion done!");
+    LOG_INFO("Conversion done, ", scenes.size() - failedCount, "/", scenes.size(), " succeeded!");
 
-    return 0;
-}
\ No newline at end of file
+    return failedCount == 0 ? 0 : EXIT_FAILURE;
+}
@@ -0,0 +1,78 @@
+#include <RenderDescription/BVH.h>
+
+#include <algorithm>
+#include <random>
+
+#include "TestCase.h"
+
+namespace
+{
+
+// Plane by plane corner test, independent of the one QueryBVHFrustum uses.
+bool IsOutsideFrustum(const vec4 planes[6], const BoundingBox& b)
+{
+    for (u32 i = 0; i < 6; i++)
+    {
+        const vec3 normal(planes[i]);
+        const vec3 positive(normal.x >= 0.0f ? b.max.x : b.min.x,
+                            normal.y >= 0.0f ? b.max.y : b.min.y,
+                            normal.z >= 0.0f ? b.max.z : b.min.z);
+
+        if (glm::dot(normal, positive) + planes[i].w < 0.0f)
+            return true;
+    }
+
+    return false;
+}
+
+} // namespace
+
+/*
+ * Small boxes scattered around a camera, so the query meets nodes fully inside, crossing and
+ * outside the frustum. It must return exactly the boxes a brute force test keeps.
+ */
+TEST_CASE(QueryBVHFrustumMatchesBruteForce)
+{
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 4.0f);
+
+    std::vector<BoundingBox> bounds(5000);
+    for (auto& b : bounds)
+    {
+        const vec3 min(position(rng), position(rng), position(rng));
+        b = BoundingBox(min, min + vec3(size(rng), size(rng), size(rng)));
+    }
+
+    BVH bvh;
+    BuildBVH(bvh, bounds);
+
+    const mat4 proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 80.0f);
+    const vec3 targets[] = {
+        vec3(0.0f, 0.0f, -1.0f),
+        vec3(1.0f, 0.5f, 0.0f),
+        vec3(-1.0f, -1.0f, 1.0f),
+    };
+
+    for (const auto& target : targets)
+    {
+        vec4 planes[6];
+        GetFrustumPlanes(proj * glm::lookAt(vec3(0.0f), target, vec3(0.0f, 1.0f, 0.0f)), planes);
+
+        std::vector<u32> expected;
+        for (u32 i = 0; i < (u32)bounds.size(); i++)
+        {
+            if (!IsOutsideFrustum(planes, bounds[i]))
+                expected.push_back(i);
+        }
+
+        std::vector<u32> items;
+        QueryBVHFrustum(bvh, planes, items);
+        std::sort(items.begin(), items.end());
+
+        TEST_CHECK(!expected.empty() && expected.size() < bounds.size());
+        TEST_CHECK(items == expected);
+    }
+
+    return true;
+}
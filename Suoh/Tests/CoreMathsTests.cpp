@@ -0,0 +1,73 @@
+#include <CoreMaths.h>
+
+#include <random>
+
+#include "TestCase.h"
+
+namespace
+{
+
+void ScalarMinMaxPositions(const float* data, size_t count, size_t stride, vec3& outMin,
+                           vec3& outMax)
+{
+    outMin = vec3(std::numeric_limits<float>::max());
+    outMax = vec3(std::numeric_limits<float>::lowest());
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const vec3 p(data[i * stride], data[i * stride + 1], data[i * stride + 2]);
+        outMin = glm::min(outMin, p);
+        outMax = glm::max(outMax, p);
+    }
+}
+
+} // namespace
+
+// Covers the SSE path (strides of 4 floats and up) and the scalar one (stride 3), with vertex
+// counts that are not multiples of 4.
+TEST_CASE(MinMaxPositionsMatchesScalar)
+{
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> distribution(-1000.0f, 1000.0f);
+
+    for (const size_t stride : {3, 4, 5, 8, 11})
+    {
+        for (const size_t count : {1, 2, 3, 4, 5, 7, 16, 61, 1023})
+        {
+            std::vector<float> data(count * stride);
+            for (auto& value : data)
+                value = distribution(rng);
+
+            vec3 expectedMin, expectedMax;
+            ScalarMinMaxPositions(data.data(), count, stride, expectedMin, expectedMax);
+
+            vec3 min, max;
+            MinMaxPositions(data.data(), count, stride, min, max);
+
+            TEST_CHECK(min == expectedMin && max == expectedMax);
+        }
+    }
+
+    return true;
+}
+
+// Positions only read 3 floats, whatever comes between them does not count.
+TEST_CASE(MinMaxPositionsIgnoresPadding)
+{
+    const size_t stride = 8;
+    std::vector<float> data(5 * stride, 1e9f);
+    for (size_t i = 0; i < 5; i++)
+    {
+        data[i * stride] = (float)i;
+        data[i * stride + 1] = -(float)i;
+        data[i * stride + 2] = 0.5f;
+    }
+
+    vec3 min, max;
+    MinMaxPositions(data.data(), 5, stride, min, max);
+
+    TEST_CHECK(min == vec3(0.0f, -4.0f, 0.5f));
+    TEST_CHECK(max == vec3(4.0f, 0.0f, 0.5f));
+
+    return true;
+}
@@ -0,0 +1,192 @@
+#include <RenderDescription/Mesh.h>
+#include <RenderLib/RenderLib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <vector>
+
+#include "Rendering/ShapeCullPass.h"
+#include "TestCase.h"
+
+namespace
+{
+
+// Mesh space bounds as CullShapes.comp reads them.
+struct MeshBounds
+{
+    vec3 min;
+    vec3 max;
+};
+
+struct CullShape
+{
+    u32 meshIndex;
+    mat4 transform;
+    bool visible;
+};
+
+template <typename T>
+BufferHandle CreateFilledBuffer(VulkanDevice* device, BufferUsage usage, std::span<const T> data)
+{
+    BufferDesc desc;
+    desc.usage = usage;
+    desc.size = (u32)data.size_bytes();
+    desc.cpuAccess = CpuAccessMode::WRITE;
+    auto buffer = device->CreateBuffer(desc);
+
+    auto mappedMemory = device->MapBuffer(buffer);
+    memcpy(mappedMemory, data.data(), data.size_bytes());
+    device->UnmapBuffer(buffer);
+
+    return buffer;
+}
+
+bool IsSameCommand(const VkDrawIndirectCommand& a, const VkDrawIndirectCommand& b)
+{
+    return a.vertexCount == b.vertexCount && a.instanceCount == b.instanceCount
+           && a.firstVertex == b.firstVertex && a.firstInstance == b.firstInstance;
+}
+
+/*
+ * Shapes around a camera looking down -z at an orthographic 20x20 window. All shapes sit at
+ * z = -5, inside the depth range for both the [-1, 1] and [0, 1] clip space conventions.
+ */
+std::vector<CullShape> MakeCullShapes()
+{
+    const mat4 identity(1.0f);
+    const mat4 quarterTurn = glm::rotate(identity, glm::half_pi<float>(), vec3(0.0f, 0.0f, 1.0f));
+
+    std::vector<CullShape> shapes = {
+        // Cube in the center.
+        {0, glm::translate(identity, vec3(0.0f, 0.0f, -5.0f)), true},
+        // Cube far to the right.
+        {0, glm::translate(identity, vec3(100.0f, 0.0f, -5.0f)), false},
+        // Cube straddling the right plane.
+        {0, glm::translate(identity, vec3(10.5f, 0.0f, -5.0f)), true},
+        // Rod along x above the top plane.
+        {1, glm::translate(identity, vec3(0.0f, 12.0f, -5.0f)), false},
+        // Same rod turned along y, reaching into the view.
+        {1, glm::translate(identity, vec3(0.0f, 12.0f, -5.0f)) * quarterTurn, true},
+        // Rod scaled down below the bottom plane.
+        {1, glm::translate(identity, vec3(0.0f, -10.6f, -5.0f)) * glm::scale(identity, vec3(0.1f)),
+         false},
+    };
+
+    // Enough shapes for several workgroups, alternating inside and behind the near plane.
+    for (u32 i = 0; i < 200; i++)
+    {
+        const bool visible = (i % 2 == 0);
+        const vec3 position(-8.0f + 0.08f * i, 0.0f, visible ? -5.0f : 50.0f);
+        shapes.push_back({0, glm::translate(identity, position), visible});
+    }
+
+    return shapes;
+}
+
+} // namespace
+
+/*
+ * Runs the cull pass on a headless device (lavapipe in CI) and checks the compacted draw commands
+ * and VisibleCount against the shapes known to be inside the frustum.
+ */
+TEST_CASE(ShapeCullPassCompactsVisibleDraws)
+{
+    auto device = CreateVulkanDevice({
+        .framebufferWidth = 1,
+        .framebufferHeight = 1,
+    });
+
+    const std::vector<MeshBounds> meshBounds = {
+        {vec3(-1.0f), vec3(1.0f)},
+        {vec3(-4.0f, -0.5f, -0.5f), vec3(4.0f, 0.5f, 0.5f)},
+    };
+
+    const auto cullShapes = MakeCullShapes();
+    const auto shapeCount = (u32)cullShapes.size();
+
+    std::vector<DrawData> drawData(shapeCount);
+    std::vector<mat4> transforms(shapeCount);
+    std::vector<VkDrawIndirectCommand> commands(shapeCount);
+    std::vector<VkDrawIndirectCommand> expectedCommands;
+    u32 expectedVertexCount = 0;
+
+    for (u32 i = 0; i < shapeCount; i++)
+    {
+        drawData[i] = {};
+        drawData[i].meshIndex = cullShapes[i].meshIndex;
+        drawData[i].transformIndex = i;
+        transforms[i] = cullShapes[i].transform;
+
+        // Distinct commands, firstInstance is the shape index as in SceneRenderer.
+        commands[i] = {3 * (i + 1), 1, 10 * i, i};
+
+        if (cullShapes[i].visible)
+        {
+            expectedCommands.push_back(commands[i]);
+            expectedVertexCount += commands[i].vertexCount;
+        }
+    }
+
+    // A single frame slot.
+    const BufferHandle shapesBuffers[] = {
+        CreateFilledBuffer<DrawData>(device.get(), BufferUsage::STORAGE_BUFFER, drawData),
+    };
+    const BufferHandle commandsBuffers[] = {
+        CreateFilledBuffer<VkDrawIndirectCommand>(
+            device.get(), BufferUsage::STORAGE_BUFFER | BufferUsage::INDIRECT_BUFFER, commands),
+    };
+    const auto transformsBuffer = CreateFilledBuffer<mat4>(
+        device.get(), BufferUsage::STORAGE_BUFFER, transforms);
+    const auto meshBoundsBuffer = CreateFilledBuffer<MeshBounds>(
+        device.get(), BufferUsage::STORAGE_BUFFER, meshBounds);
+
+    ShapeCullPass cullPass(device.get());
+    TEST_CHECK(cullPass.Init(shapeCount, shapesBuffers, commandsBuffers, transformsBuffer,
+                             meshBoundsBuffer));
+
+    BufferDesc readbackDesc;
+    readbackDesc.usage = BufferUsage::STORAGE_BUFFER;
+    readbackDesc.size = shapeCount * sizeof(VkDrawIndirectCommand);
+    readbackDesc.cpuAccess = CpuAccessMode::READ;
+    auto readbackBuffer = device->CreateBuffer(readbackDesc);
+
+    const mat4 viewProj = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, -10.0f, 10.0f);
+
+    auto commandList = device->CreateCommandList({});
+    commandList->Begin();
+    cullPass.Record(commandList, 0, viewProj);
+
+    const auto& visibleCommands = cullPass.GetVisibleCommands(0);
+    commandList->BufferBarrier(visibleCommands, vk::PipelineStageFlagBits::eComputeShader,
+                               vk::AccessFlagBits::eShaderWrite,
+                               vk::PipelineStageFlagBits::eTransfer,
+                               vk::AccessFlagBits::eTransferRead);
+    commandList->CopyBuffer(visibleCommands, readbackBuffer, readbackDesc.size);
+    commandList->BufferBarrier(readbackBuffer, vk::PipelineStageFlagBits::eTransfer,
+                               vk::AccessFlagBits::eTransferWrite, vk::PipelineStageFlagBits::eHost,
+                               vk::AccessFlagBits::eHostRead);
+    commandList->End();
+
+    device->Submit(commandList);
+    device->WaitIdle();
+
+    const VisibleCount visibleCount = cullPass.ReadVisibleCount(0);
+    TEST_CHECK(visibleCount.drawCount == expectedCommands.size());
+    TEST_CHECK(visibleCount.vertexCount == expectedVertexCount);
+
+    std::vector<VkDrawIndirectCommand> survivors(visibleCount.drawCount);
+    auto mappedMemory = device->MapBuffer(readbackBuffer);
+    memcpy(survivors.data(), mappedMemory, survivors.size() * sizeof(VkDrawIndirectCommand));
+    device->UnmapBuffer(readbackBuffer);
+
+    // Invocations append in any order, firstInstance is the shape index.
+    const auto byShape = [](const VkDrawIndirectCommand& a, const VkDrawIndirectCommand& b) {
+        return a.firstInstance < b.firstInstance;
+    };
+    std::sort(survivors.begin(), survivors.end(), byShape);
+    TEST_CHECK(std::equal(survivors.begin(), survivors.end(), expectedCommands.begin(),
+                          expectedCommands.end(), IsSameCommand));
+
+    return true;
+}
@@ -0,0 +1,330 @@
+#include <RenderDescription/Scene.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+#include "TestCase.h"
+
+namespace
+{
+
+std::string MakeNodeName(u32 index)
+{
+    return "node" + std::to_string(index);
+}
+
+/*
+ * Random level ordered scene. Node i is named MakeNodeName(i) and carries mesh id i, so both can
+ * identify it after nodes were deleted and the rest remapped.
+ */
+Scene MakeRandomScene(std::mt19937& rng, u32 nodeCount)
+{
+    Scene scene;
+    const u32 root = AddNode(scene, u32(-1), 0);
+    SetNodeName(scene, root, MakeNodeName(0));
+    SetComponent(scene.meshIds, root, 0);
+
+    for (u32 i = 1; i < nodeCount; i++)
+    {
+        u32 parent = rng() % i;
+        if (scene.hierarchy[parent].level + 1 >= MAX_SCENE_LEVEL)
+            parent = root;
+
+        const u32 node = AddNode(scene, parent, scene.hierarchy[parent].level + 1);
+        SetNodeName(scene, node, MakeNodeName(i));
+        SetComponent(scene.meshIds, node, i);
+    }
+
+    ReorderSceneByLevel(scene);
+    return scene;
+}
+
+// Marks every node in the subtrees of nodes.
+std::vector<u8> MarkSubtrees(const Scene& scene, const std::vector<u32>& nodes)
+{
+    std::vector<u8> marked(scene.hierarchy.size(), 0);
+    std::vector<u32> stack(nodes.begin(), nodes.end());
+    while (!stack.empty())
+    {
+        const u32 node = stack.back();
+        stack.pop_back();
+
+        marked[node] = 1;
+        for (u32 c = scene.hierarchy[node].firstChild; c != u32(-1);
+             c = scene.hierarchy[c].nextSibling)
+            stack.push_back(c);
+    }
+
+    return marked;
+}
+
+bool CheckHierarchy(const Scene& scene)
+{
+    const u32 nodeCount = (u32)scene.hierarchy.size();
+
+    std::vector<u32> chainCount(nodeCount, 0);
+    for (u32 node = 0; node < nodeCount; node++)
+    {
+        const auto& h = scene.hierarchy[node];
+
+        if (h.parent == u32(-1))
+        {
+            TEST_CHECK(h.level == 0);
+        }
+        else
+        {
+            TEST_CHECK(h.parent < node);
+            TEST_CHECK(scene.hierarchy[h.parent].level + 1 == h.level);
+        }
+
+        u32 lastChild = u32(-1);
+        for (u32 c = h.firstChild; c != u32(-1); c = scene.hierarchy[c].nextSibling)
+        {
+            TEST_CHECK(c < nodeCount);
+            TEST_CHECK(scene.hierarchy[c].parent == node);
+            TEST_CHECK(++chainCount[c] == 1);
+            lastChild = c;
+        }
+
+        // Only the first child caches the end of the chain.
+        if (h.firstChild != u32(-1))
+            TEST_CHECK(scene.hierarchy[h.firstChild].lastSibling == lastChild);
+    }
+
+    // Every node with a parent is in exactly one sibling chain, its parent's.
+    for (u32 node = 0; node < nodeCount; node++)
+        TEST_CHECK(chainCount[node] == (scene.hierarchy[node].parent != u32(-1) ? 1u : 0u));
+
+    TEST_CHECK(IsSceneSortedByLevel(scene));
+
+    return true;
+}
+
+// Sources for the merge tests, with a material per node and a distinct transform per root.
+std::vector<Scene> MakeMergeSources(std::mt19937& rng)
+{
+    std::vector<Scene> sources(4);
+    sources[0] = MakeRandomScene(rng, 300);
+
+    // Empty, but owning meshes and materials the later scenes are offset past.
+    sources[1].materialNames = {"empty0", "empty1"};
+
+    // Two roots, the second with a child.
+    auto& twoRoots = sources[2];
+    for (u32 i = 0; i < 3; i++)
+    {
+        const u32 node = AddNode(twoRoots, (i == 2) ? 1 : u32(-1), (i == 2) ? 1 : 0);
+        SetNodeName(twoRoots, node, MakeNodeName(i));
+        SetComponent(twoRoots.meshIds, node, i);
+    }
+
+    sources[3] = MakeRandomScene(rng, 200);
+
+    for (auto& source : sources)
+    {
+        if (source.hierarchy.empty())
+            continue;
+
+        source.materialNames = {"material0", "material1", "material2"};
+        for (u32 node = 0; node < (u32)source.hierarchy.size(); node++)
+        {
+            SetComponent(source.materialIds, node, node % 3);
+            source.localTransforms[node] = glm::translate(mat4(1.0f), vec3(float(node), 0, 0));
+        }
+    }
+
+    return sources;
+}
+
+/*
+ * Every source node is found in merged through its offset mesh id, below its own parent or the
+ * merged root, with offset material ids and its name. Linear searches, test sized scenes only.
+ */
+bool CheckMergedScene(const Scene& merged, const std::vector<Scene>& sources,
+                      const std::vector<u32>& meshCounts, const std::vector<mat4>& rootTransforms)
+{
+    if (!CheckHierarchy(merged))
+        return false;
+
+    std::vector<u32> meshOffsets;
+    std::vector<u32> materialOffsets;
+    u32 meshOffset = 0;
+    u32 materialOffset = 0;
+    u32 sourceNodeCount = 0;
+    u32 sourceRootCount = 0;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        meshOffsets.push_back(meshOffset);
+        materialOffsets.push_back(materialOffset);
+        meshOffset += meshCounts[i];
+        materialOffset += (u32)sources[i].materialNames.size();
+        sourceNodeCount += (u32)sources[i].hierarchy.size();
+        for (const auto& h : sources[i].hierarchy)
+            sourceRootCount += (h.parent == u32(-1)) ? 1 : 0;
+    }
+
+    TEST_CHECK(merged.hierarchy.size() == sourceNodeCount + 1);
+    TEST_CHECK(merged.materialNames.size() == materialOffset);
+
+    u32 rootChildCount = 0;
+    for (u32 c = merged.hierarchy[0].firstChild; c != u32(-1); c = merged.hierarchy[c].nextSibling)
+        rootChildCount++;
+    TEST_CHECK(rootChildCount == sourceRootCount);
+
+    for (u32 node = 1; node < (u32)merged.hierarchy.size(); node++)
+    {
+        const u32 meshId = GetComponent(merged.meshIds, node);
+        TEST_CHECK(meshId != u32(-1));
+
+        size_t k = sources.size() - 1;
+        while (meshId < meshOffsets[k])
+            k--;
+
+        // Mesh ids are unique within a source.
+        const Scene& source = sources[k];
+        const auto& sourceMeshIds = source.meshIds.values;
+        const auto it =
+            std::find(sourceMeshIds.begin(), sourceMeshIds.end(), meshId - meshOffsets[k]);
+        TEST_CHECK(it != sourceMeshIds.end());
+        const u32 original = source.meshIds.nodes[it - sourceMeshIds.begin()];
+
+        const auto& h = merged.hierarchy[node];
+        const auto& originalH = source.hierarchy[original];
+        TEST_CHECK(h.level == originalH.level + 1);
+        TEST_CHECK(GetNodeName(merged, node) == GetNodeName(source, original));
+        TEST_CHECK(GetComponent(merged.materialIds, node)
+                   == GetComponent(source.materialIds, original) + materialOffsets[k]);
+
+        if (originalH.parent == u32(-1))
+        {
+            TEST_CHECK(h.parent == 0);
+            TEST_CHECK(merged.localTransforms[node]
+                       == rootTransforms[k] * source.localTransforms[original]);
+        }
+        else
+        {
+            TEST_CHECK(GetComponent(merged.meshIds, h.parent)
+                       == GetComponent(source.meshIds, originalH.parent) + meshOffsets[k]);
+            TEST_CHECK(merged.localTransforms[node] == source.localTransforms[original]);
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+TEST_CASE(DeleteSceneNodesKeepsHierarchyIntact)
+{
+    std::mt19937 rng(42);
+
+    for (u32 iteration = 0; iteration < 16; iteration++)
+    {
+        const u32 nodeCount = 500 + (u32)(rng() % 4000);
+        Scene scene = MakeRandomScene(rng, nodeCount);
+
+        // Duplicates and nodes inside deleted subtrees are allowed, the root is kept.
+        std::vector<u32> nodesToDelete;
+        const u32 deleteCount = 1 + (u32)(rng() % (nodeCount / 10));
+        for (u32 i = 0; i < deleteCount; i++)
+            nodesToDelete.push_back(1 + (u32)(rng() % (nodeCount - 1)));
+
+        const auto deleted = MarkSubtrees(scene, nodesToDelete);
+
+        // Deleted and kept nodes, by the name given at creation.
+        std::vector<u8> deletedIds(nodeCount, 0);
+        u32 keptCount = 0;
+        for (u32 node = 0; node < nodeCount; node++)
+        {
+            deletedIds[GetComponent(scene.meshIds, node)] = deleted[node];
+            keptCount += deleted[node] ? 0 : 1;
+        }
+
+        DeleteSceneNodes(scene, nodesToDelete);
+
+        TEST_CHECK(scene.hierarchy.size() == keptCount);
+        TEST_CHECK(scene.localTransforms.size() == keptCount);
+        TEST_CHECK(scene.globalTransforms.size() == keptCount);
+        TEST_CHECK(scene.meshIds.size() == keptCount);
+
+        if (!CheckHierarchy(scene))
+            return false;
+
+        // Components were remapped along with the nodes and names resolve to the new indices.
+        for (u32 node = 0; node < keptCount; node++)
+        {
+            const u32 id = GetComponent(scene.meshIds, node);
+            TEST_CHECK(id < nodeCount && !deletedIds[id]);
+            TEST_CHECK(GetNodeName(scene, node) == MakeNodeName(id));
+            TEST_CHECK(FindNodeByName(scene, MakeNodeName(id)) == node);
+        }
+
+        for (u32 id = 0; id < nodeCount; id++)
+        {
+            if (deletedIds[id])
+                TEST_CHECK(FindNodeByName(scene, MakeNodeName(id)) == u32(-1));
+        }
+    }
+
+    return true;
+}
+
+TEST_CASE(MarkAsChangedQueuesNodesAddedUnderQueuedParent)
+{
+    Scene scene;
+    const u32 root = AddNode(scene, u32(-1), 0);
+    const u32 child = AddNode(scene, root, 1);
+
+    scene.localTransforms[root] = glm::translate(mat4(1.0f), vec3(1.0f, 2.0f, 3.0f));
+    MarkAsChanged(scene, root);
+
+    // Added below the queued root, marking the root again skips the whole subtree.
+    const u32 grandChild = AddNode(scene, child, 2);
+    scene.localTransforms[grandChild] = glm::translate(mat4(1.0f), vec3(0.0f, 0.0f, 1.0f));
+    TEST_CHECK(MarkAsChanged(scene, root) == 0);
+
+    TEST_CHECK(RecalculateGlobalTransforms(scene) == 3);
+    TEST_CHECK(scene.globalTransforms[grandChild]
+               == glm::translate(mat4(1.0f), vec3(1.0f, 2.0f, 4.0f)));
+
+    return true;
+}
+
+TEST_CASE(MergeScenesLinksEveryRootAndOffsetsIds)
+{
+    std::mt19937 rng(7);
+    const auto sources = MakeMergeSources(rng);
+
+    const std::vector<u32> meshCounts = {300, 5, 3, 200};
+    std::vector<mat4> rootTransforms;
+    for (u32 i = 0; i < (u32)sources.size(); i++)
+        rootTransforms.push_back(glm::translate(mat4(1.0f), vec3(0, float(i + 1), 0)));
+
+    // Read in place, the sources are left untouched.
+    std::vector<Scene*> sourcePointers;
+    for (const auto& source : sources)
+        sourcePointers.push_back(const_cast<Scene*>(&source));
+
+    Scene merged;
+    MergeScenes(merged, sourcePointers, rootTransforms, meshCounts);
+    if (!CheckMergedScene(merged, sources, meshCounts, rootTransforms))
+        return false;
+
+    TEST_CHECK(sources[0].hierarchy.size() == 300);
+
+    // Every merged node is queued, the new root was never changed.
+    TEST_CHECK(RecalculateGlobalTransforms(merged) == merged.hierarchy.size() - 1);
+
+    // Consumed sources give the same scene and are released.
+    std::vector<Scene> consumed = sources;
+    Scene appended;
+    MergeScenesInto(appended, std::move(consumed), rootTransforms, meshCounts);
+    if (!CheckMergedScene(appended, sources, meshCounts, rootTransforms))
+        return false;
+
+    for (const auto& source : consumed)
+        TEST_CHECK(source.hierarchy.empty() && source.names.empty());
+
+    return true;
+}
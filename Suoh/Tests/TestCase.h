@@ -0,0 +1,42 @@
+#pragma once
+
+#include <CoreTypes.h>
+#include <Logger.h>
+
+#include <vector>
+
+/*
+ * Minimal test registry. Every TEST_CASE registers itself before main runs, the test executable
+ * runs the cases named on its command line, or all of them.
+ */
+struct TestCase
+{
+    const char* name;
+    bool (*run)();
+};
+
+std::vector<TestCase>& GetTestCases();
+
+struct TestRegistration
+{
+    TestRegistration(const char* name, bool (*run)())
+    {
+        GetTestCases().push_back({name, run});
+    }
+};
+
+#define TEST_CASE(name)                                                                            \
+    static bool name();                                                                            \
+    static const TestRegistration name##Registration(#name, name);                                 \
+    static bool name()
+
+// Fails the current test case if condition does not hold.
+#define TEST_CHECK(condition)                                                                      \
+    do                                                                                             \
+    {                                                                                              \
+        if (!(condition))                                                                          \
+        {                                                                                          \
+            LOG_ERROR(__FILE__, ":", __LINE__, ": check failed: ", #condition);                    \
+            return false;                                                                          \
+        }                                                                                          \
+    } while (0)
@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string_view>
+
+#include "TestCase.h"
+
+std::vector<TestCase>& GetTestCases()
+{
+    static std::vector<TestCase> testCases;
+    return testCases;
+}
+
+int main(int argc, char** argv)
+{
+    LOG_SET_OUTPUT(&std::cout);
+
+    u32 runCount = 0;
+    u32 failedCount = 0;
+    for (const auto& testCase : GetTestCases())
+    {
+        bool selected = (argc < 2);
+        for (int i = 1; i < argc; i++)
+            selected = selected || (std::string_view(argv[i]) == testCase.name);
+
+        if (!selected)
+            continue;
+
+        runCount++;
+        if (testCase.run())
+        {
+            LOG_INFO("Passed ", testCase.name);
+        }
+        else
+        {
+            LOG_ERROR("Failed ", testCase.name);
+            failedCount++;
+        }
+    }
+
+    if (runCount == 0)
+    {
+        LOG_ERROR("No test case matched the command line");
+        return 1;
+    }
+
+    return failedCount == 0 ? 0 : 1;
+}